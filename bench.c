@@ -0,0 +1,957 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mineboard.h"
+#include "snakebody.h"
+#include "snakefield.h"
+#include "snakegame.h"
+#include "tttboard.h"
+#include "tttmcts.h"
+#include "tttsearch.h"
+#include "ttttable.h"
+#include "utils.h"
+
+#define CASCADE_LEN 4096
+#define RIG_LEN 3163 // About 10 million cells
+#define SNAKE_MOVES 10000000
+#define FILL_WIDTH 200
+#define FILL_HEIGHT 100
+#define FILL_TICKS 1000000
+#define TABLE_REPEATS 1000
+#define MCTS_SIDE 19
+#define MCTS_MS 1000
+#define SAMPLES 10 // Each microbenchmark is timed this many times, to show how much it varies
+#define EXPERT_WIDTH 30
+#define EXPERT_HEIGHT 16
+#define EXPERT_MINES 99
+
+// An operation timed on its own: run(param, ops, seed) does any setup it needs and returns the milliseconds the ops
+// themselves took
+struct micro
+{
+    const char *name;
+    double (*run)(int param, long long ops, uint64_t seed);
+    int param;
+    long long ops;
+};
+
+static void bench_cascade(int len, int density_percent);
+static void bench_rig(int len, int density_percent);
+static void bench_counts(int width, int height, int repeat);
+static void count_per_cell(struct board *b, const uint64_t *plane);
+static void bench_snake_moves(int length);
+static void bench_snake_fill(int fill_percent);
+static void cycle_cell(int step, int *x, int *y);
+static int flood_fill(struct board *b, int start, int *stack);
+static int bench_ttt_table();
+static void ttt_walk(struct ttt_board *b, int *cells, int index, bool *seen, int *positions, int *n);
+static int ttt_index(const int *cells);
+static void bench_ttt_mcts(int threads, double *single);
+static void run_micro(const struct micro *m, bool csv);
+static double micro_rig(int param, long long ops, uint64_t seed);
+static double micro_counts(int param, long long ops, uint64_t seed);
+static double micro_reveal(int param, long long ops, uint64_t seed);
+static double micro_won(int param, long long ops, uint64_t seed);
+static double micro_snake_move(int length, long long ops, uint64_t seed);
+static double micro_spawn_food(int length, long long ops, uint64_t seed);
+static double micro_ttt_wins(int stones, long long ops, uint64_t seed);
+static double micro_ttt_place(int stones, long long ops, uint64_t seed);
+static void random_stones(struct ttt_board *b, int stones, struct rng *r, int *cells);
+
+// The game's hot paths, each on its own
+static const struct micro MICROS[] = {
+    { "mine_rig_expert", micro_rig, 0, 20000 },
+    { "mine_counts_expert", micro_counts, 0, 200000 },
+    { "mine_reveal_expert", micro_reveal, 0, 1000000 },
+    { "mine_won", micro_won, 0, 100000000 },
+    { "snake_move_10", micro_snake_move, 10, 2000000 },
+    { "snake_move_1000", micro_snake_move, 1000, 2000000 },
+    { "snake_move_10000", micro_snake_move, 10000, 2000000 },
+    { "snake_spawn_food_10", micro_spawn_food, 10, 2000000 },
+    { "snake_spawn_food_10000", micro_spawn_food, 10000, 2000000 },
+    { "snake_spawn_food_19000", micro_spawn_food, 19000, 2000000 },
+    { "ttt_wins_19x19", micro_ttt_wins, 100, 10000000 },
+    { "ttt_place_undo_19x19", micro_ttt_place, 100, 2000000 },
+};
+
+// With --csv only the microbenchmarks run, printed as comma separated values to compare between builds. With --check
+// only the Tic Tac Toe table is checked against the search. A table that disagrees with the search fails the run
+int main(int argc, char *argv[])
+{
+    bool csv = argc > 1 && strcmp(argv[1], "--csv") == 0;
+    bool check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    int micro_n = (int) (sizeof(MICROS) / sizeof(MICROS[0]));
+    if (csv)
+    {
+        printf("name,ns_per_op,stddev_ns,min_ns,samples\n");
+        for (int i = 0; i < micro_n; i++)
+        {
+            run_micro(&MICROS[i], true);
+        }
+        return 0;
+    }
+    const char *table_header = "\nTic Tac Toe 3x3, the perfect play table checked against a full search of every position\n";
+    if (check)
+    {
+        printf("%s", table_header + 1);
+        return bench_ttt_table() == 0 ? 0 : 1;
+    }
+
+    printf("Minesweeper cascade on %ix%i boards\n", CASCADE_LEN, CASCADE_LEN);
+    printf("%-8s %-10s %-14s %-12s %-12s %-12s %-12s\n", "density", "regions", "largest", "rig ms", "index ms", "cascade ms",
+           "flood ms");
+    int densities[] = { 5, 10, 15, 20 };
+    for (int i = 0; i < 4; i++)
+    {
+        bench_cascade(CASCADE_LEN, densities[i]);
+    }
+
+    printf("\nMinesweeper mine placement on %ix%i boards\n", RIG_LEN, RIG_LEN);
+    printf("%-8s %-12s %-12s %-12s\n", "density", "mines", "rig ms", "index ms");
+    int rig_densities[] = { 10, 50, 90, 99 };
+    for (int i = 0; i < 4; i++)
+    {
+        bench_rig(RIG_LEN, rig_densities[i]);
+    }
+
+    printf("\nMinesweeper adjacent mine counts, 20%% mines\n");
+    printf("%-12s %-10s %-16s %-16s %-8s\n", "board", "repeats", "per cell ns", "bitplane ns", "speedup");
+    bench_counts(9, 9, 200000);
+    bench_counts(30, 16, 50000);
+    bench_counts(4096, 4096, 3);
+
+    printf("\nSnake moves by snake length\n");
+    printf("%-10s %-16s %-16s\n", "length", "ring ns/move", "shift ns/move");
+    for (int length = 1; length <= 1000000; length *= 10)
+    {
+        bench_snake_moves(length);
+    }
+
+    printf("\nSnake ticks on a %ix%i field, spawning food every tick\n", FILL_WIDTH, FILL_HEIGHT);
+    printf("%-8s %-10s %-16s %-16s\n", "fill", "length", "bitmap ns/tick", "scan ns/tick");
+    int fills[] = { 10, 50, 90, 99 };
+    for (int i = 0; i < 4; i++)
+    {
+        bench_snake_fill(fills[i]);
+    }
+
+    printf("%s", table_header);
+    int table_mismatches = bench_ttt_table();
+
+    printf("\nTic Tac Toe random games on a %ix%i board, 5 in a row, by threads\n", MCTS_SIDE, MCTS_SIDE);
+    printf("%-8s %-12s %-16s %-8s\n", "threads", "games", "games/s", "speedup");
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    double single = 0;
+    for (int threads = 1; threads < cores; threads *= 2)
+    {
+        bench_ttt_mcts(threads, &single);
+    }
+    bench_ttt_mcts(cores > 0 ? (int) cores : 1, &single);
+
+    printf("\nHot paths on their own, over %i samples\n", SAMPLES);
+    printf("%-24s %-12s %-12s %-12s\n", "name", "ns/op", "stddev ns", "min ns");
+    for (int i = 0; i < micro_n; i++)
+    {
+        run_micro(&MICROS[i], false);
+    }
+    return table_mismatches == 0 ? 0 : 1;
+}
+
+
+// Time rigging the board, indexing its regions and opening the largest one, compared to flood filling it one cell
+// at a time
+static void bench_cascade(int len, int density_percent)
+{
+    struct board b;
+    int mines = (int) ((long long) len * len * density_percent / 100);
+    if (!board_init(&b, len, len, mines))
+    {
+        printf("Failed to allocate the board\n");
+        return;
+    }
+
+    struct rng r;
+    rng_seed(&r, density_percent);
+    double start = now_ms();
+    bool ok = board_rig_mines(&b, &r, 0, 0);
+    double rig_ms = now_ms() - start;
+    start = now_ms();
+    if (!ok || !board_index_regions(&b))
+    {
+        printf("Failed to index the board\n");
+        board_free(&b);
+        return;
+    }
+    double index_ms = now_ms() - start;
+
+    // Find the largest region and one of its cells
+    int largest = 0;
+    for (int r = 1; r < b.regions; r++)
+    {
+        if (b.region_start[r + 1] - b.region_start[r] > b.region_start[largest + 1] - b.region_start[largest])
+        {
+            largest = r;
+        }
+    }
+    int cell = 0;
+    for (int j = b.region_start[largest]; b.region[cell] != largest; j++)
+    {
+        cell = b.region_cells[j];
+    }
+    int largest_n = b.region_start[largest + 1] - b.region_start[largest];
+
+    // Flood fill a copy of the board
+    uint8_t *cells = malloc(b.size);
+    int *stack = malloc((size_t) b.size * sizeof(int));
+    memcpy(cells, b.cells, b.size);
+    uint8_t *original = b.cells;
+    b.cells = cells;
+    start = now_ms();
+    flood_fill(&b, cell, stack);
+    double flood_ms = now_ms() - start;
+    b.cells = original;
+    free(cells);
+    free(stack);
+
+    start = now_ms();
+    board_reveal(&b, cell % len, cell / len);
+    double cascade_ms = now_ms() - start;
+
+    printf("%-8i %-10i %-14i %-12.3f %-12.3f %-12.3f %-12.3f\n", density_percent, b.regions, largest_n, rig_ms, index_ms,
+           cascade_ms, flood_ms);
+    board_free(&b);
+}
+
+// Time placing the mines, which should take about as long at any density, and then indexing the regions, which
+// the first cascade does
+static void bench_rig(int len, int density_percent)
+{
+    struct board b;
+    int mines = (int) ((long long) len * len * density_percent / 100);
+    if (!board_init(&b, len, len, mines))
+    {
+        printf("Failed to allocate the board\n");
+        return;
+    }
+
+    struct rng r;
+    rng_seed(&r, density_percent);
+    double start = now_ms();
+    bool ok = board_rig_mines(&b, &r, len / 2, len / 2);
+    double rig_ms = now_ms() - start;
+    start = now_ms();
+    ok = ok && board_index_regions(&b);
+    double index_ms = now_ms() - start;
+    if (ok)
+    {
+        printf("%-8i %-12i %-12.3f %-12.3f\n", density_percent, mines, rig_ms, index_ms);
+    }
+    else
+    {
+        printf("Failed to index the board\n");
+    }
+    board_free(&b);
+}
+
+// Time counting the adjacent mines of every cell one neighbour at a time, against counting whole rows of a bitplane.
+// Times are per cell
+static void bench_counts(int width, int height, int repeat)
+{
+    struct board b;
+    if (!board_init(&b, width, height, 0))
+    {
+        printf("Failed to allocate the board\n");
+        return;
+    }
+    int stride = board_plane_stride(&b);
+    uint64_t *plane = calloc((size_t) stride * height, sizeof(uint64_t));
+    uint8_t *expected = malloc(b.size);
+    if (plane == NULL || expected == NULL)
+    {
+        printf("Failed to allocate the board\n");
+        free(plane);
+        free(expected);
+        board_free(&b);
+        return;
+    }
+    struct rng r;
+    rng_seed(&r, width);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            plane[y * stride + x / 64] |= (uint64_t) (rng_range(&r, 0, 99) < 20) << (x % 64);
+        }
+    }
+
+    double start = now_ms();
+    for (int i = 0; i < repeat; i++)
+    {
+        memset(b.cells, 0, b.size);
+        count_per_cell(&b, plane);
+    }
+    double per_cell_ms = now_ms() - start;
+    memcpy(expected, b.cells, b.size);
+
+    start = now_ms();
+    for (int i = 0; i < repeat; i++)
+    {
+        memset(b.cells, 0, b.size);
+        board_fill_counts(&b, plane);
+    }
+    double plane_ms = now_ms() - start;
+
+    double cells = (double) b.size * repeat;
+    char name[32];
+    snprintf(name, sizeof(name), "%ix%i", width, height);
+    printf("%-12s %-10i %-16.3f %-16.3f %-8.1f%s\n", name, repeat, per_cell_ms * 1e6 / cells, plane_ms * 1e6 / cells,
+           per_cell_ms / plane_ms, memcmp(expected, b.cells, b.size) == 0 ? "" : " (counts differ!)");
+    free(plane);
+    free(expected);
+    board_free(&b);
+}
+
+// Counts the mines around every cell by checking each of its neighbours, the way boards used to be generated
+static void count_per_cell(struct board *b, const uint64_t *plane)
+{
+    int stride = board_plane_stride(b);
+    for (int y = 0; y < b->height; y++)
+    {
+        for (int x = 0; x < b->width; x++)
+        {
+            *board_cell(b, x, y) |= (plane[y * stride + x / 64] >> (x % 64) & 1) ? CELL_MINE : 0;
+        }
+    }
+    for (int y = 0; y < b->height; y++)
+    {
+        for (int x = 0; x < b->width; x++)
+        {
+            int adjacent_mines = 0;
+            for (int a_y = y - 1; a_y <= y + 1; a_y++)
+            {
+                for (int a_x = x - 1; a_x <= x + 1; a_x++)
+                {
+                    if ((a_x != x || a_y != y) && board_contains(b, a_x, a_y) && (*board_cell(b, a_x, a_y) & CELL_MINE))
+                    {
+                        adjacent_mines++;
+                    }
+                }
+            }
+            *board_cell(b, x, y) |= adjacent_mines;
+        }
+    }
+}
+
+// Time moving a snake of the given length, as a ring buffer and by shifting every segment the way it used to
+static void bench_snake_moves(int length)
+{
+    struct body b;
+    int *shift_x = malloc((size_t) length * sizeof(int));
+    int *shift_y = malloc((size_t) length * sizeof(int));
+    if (shift_x == NULL || shift_y == NULL || !body_init(&b, 0, 0))
+    {
+        printf("Failed to allocate the snake\n");
+        free(shift_x);
+        free(shift_y);
+        return;
+    }
+    for (int i = 1; i < length; i++)
+    {
+        body_push(&b, i, 0);
+    }
+    for (int i = 0; i < length; i++)
+    {
+        shift_x[i] = i;
+        shift_y[i] = 0;
+    }
+
+    double start = now_ms();
+    for (int i = 0; i < SNAKE_MOVES; i++)
+    {
+        struct segment head = body_head(&b);
+        body_push(&b, head.x + 1, head.y);
+        body_pop(&b);
+    }
+    double ring_ms = now_ms() - start;
+
+    // Shifting is too slow to move long snakes as often
+    int moves = SNAKE_MOVES / length > 10 ? SNAKE_MOVES / length : 10;
+    start = now_ms();
+    for (int m = 0; m < moves; m++)
+    {
+        for (int i = 0; i < length - 1; i++)
+        {
+            shift_x[i] = shift_x[i + 1];
+            shift_y[i] = shift_y[i + 1];
+        }
+        shift_x[length - 1]++;
+    }
+    double shift_ms = now_ms() - start;
+
+    printf("%-10i %-16.3f %-16.3f\n", length, ring_ms * 1e6 / SNAKE_MOVES, shift_ms * 1e6 / moves);
+    body_free(&b);
+    free(shift_x);
+    free(shift_y);
+}
+
+// Time a tick of a snake filling part of the field: moving, checking for collisions and spawning food. The snake
+// follows a cycle through every cell so it never hits itself. Compared to scanning the body for collisions and
+// retrying random cells until one isn't taken by the body, the way it used to work
+static void bench_snake_fill(int fill_percent)
+{
+    struct field f;
+    struct body b;
+    int length = FILL_WIDTH * FILL_HEIGHT * fill_percent / 100;
+    if (!field_init(&f, FILL_WIDTH, FILL_HEIGHT) || !body_init(&b, 0, 0))
+    {
+        printf("Failed to allocate the field\n");
+        return;
+    }
+    field_occupy(&f, 0, 0);
+    for (int step = 1; step < length; step++)
+    {
+        int x, y;
+        cycle_cell(step, &x, &y);
+        body_push(&b, x, y);
+        field_occupy(&f, x, y);
+    }
+
+    int collisions = 0;
+    long long food = 0;
+    double start = now_ms();
+    for (int step = length; step < length + FILL_TICKS; step++)
+    {
+        int x, y;
+        cycle_cell(step, &x, &y);
+        struct segment tail = body_at(&b, 0);
+        field_release(&f, tail.x, tail.y);
+        body_pop(&b);
+        collisions += field_is_occupied(&f, x, y) ? 1 : 0;
+        body_push(&b, x, y);
+        field_occupy(&f, x, y);
+        food += field_random_free(&f);
+    }
+    double bitmap_ms = now_ms() - start;
+
+    // Scanning is too slow to run as many ticks
+    int scan_ticks = FILL_TICKS / 1000;
+    start = now_ms();
+    for (int step = length + FILL_TICKS; step < length + FILL_TICKS + scan_ticks; step++)
+    {
+        int x, y;
+        cycle_cell(step, &x, &y);
+        body_pop(&b);
+        for (int i = 0; i < b.length; i++)
+        {
+            struct segment segment = body_at(&b, i);
+            collisions += segment.x == x && segment.y == y ? 1 : 0;
+        }
+        body_push(&b, x, y);
+
+        bool taken;
+        do
+        {
+            int food_x = rand_range(0, FILL_WIDTH - 1);
+            int food_y = rand_range(0, FILL_HEIGHT - 1);
+            taken = false;
+            for (int i = 0; i < b.length && !taken; i++)
+            {
+                struct segment segment = body_at(&b, i);
+                taken = segment.x == food_x && segment.y == food_y;
+            }
+            food += food_x;
+        } while (taken);
+    }
+    double scan_ms = now_ms() - start;
+
+    printf("%-8i %-10i %-16.1f %-16.1f%s\n", fill_percent, length, bitmap_ms * 1e6 / FILL_TICKS,
+           scan_ms * 1e6 / scan_ticks, collisions == 0 && food != 0 ? "" : " (snake collided!)");
+    body_free(&b);
+    field_free(&f);
+}
+
+// The cell at a step of a cycle through every cell of the field: along the top row, then down and up the columns
+static void cycle_cell(int step, int *x, int *y)
+{
+    step %= FILL_WIDTH * FILL_HEIGHT;
+    if (step < FILL_WIDTH)
+    {
+        *x = step;
+        *y = 0;
+        return;
+    }
+    step -= FILL_WIDTH;
+    int column = FILL_WIDTH - 1 - step / (FILL_HEIGHT - 1);
+    int row = step % (FILL_HEIGHT - 1);
+    *x = column;
+    *y = (FILL_WIDTH - 1 - column) % 2 == 0 ? 1 + row : FILL_HEIGHT - 1 - row;
+}
+
+// Opens cells the way a flood fill would, using a stack so huge regions don't overflow the call stack
+static int flood_fill(struct board *b, int start, int *stack)
+{
+    int length = 0;
+    int opened = 0;
+    stack[length++] = start;
+    b->cells[start] |= CELL_OPENED;
+    while (length > 0)
+    {
+        int i = stack[--length];
+        opened++;
+        if ((b->cells[i] & CELL_COUNT_MASK) > 0)
+        {
+            continue;
+        }
+        int x = i % b->width;
+        int y = i / b->width;
+        for (int a_y = y - 1; a_y <= y + 1; a_y++)
+        {
+            for (int a_x = x - 1; a_x <= x + 1; a_x++)
+            {
+                if (board_contains(b, a_x, a_y) && !(*board_cell(b, a_x, a_y) & CELL_OPENED))
+                {
+                    *board_cell(b, a_x, a_y) |= CELL_OPENED;
+                    stack[length++] = a_y * b->width + a_x;
+                }
+            }
+        }
+    }
+    return opened;
+}
+
+// Look up the move of every position the game can reach that isn't over, and check that a search to the end of
+// the game scores it the same and that the move keeps that score. The table searches no nodes at all, so its time
+// is only working out the index from the cells. Returns the number of positions that disagree, -1 if the search
+// couldn't be allocated
+static int bench_ttt_table()
+{
+    printf("%-10s %-12s %-16s %-16s %-12s\n", "positions", "mismatches", "table ns/move", "search us/move",
+           "search nodes");
+    struct ttt_board b;
+    struct ttt_search s;
+    if (!ttt_init(&b, 3, 3, 3) || !ttt_search_init(&s, 16))
+    {
+        printf("Failed to allocate the search\n");
+        return -1;
+    }
+    static bool seen[TTT_TABLE_SIZE];
+    static int positions[TTT_TABLE_SIZE * 9];
+    int cells[9] = { 0 };
+    int n = 0;
+    ttt_walk(&b, cells, 0, seen, positions, &n);
+
+    // Walk the positions again, searching each one from scratch
+    int mismatches = 0;
+    long long nodes = 0;
+    double search_ms = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const int *p = &positions[i * 9];
+        int index = ttt_index(p);
+        ttt_init(&b, 3, 3, 3);
+        for (int player = 1; player <= 2; player++)
+        {
+            for (int cell = 0; cell < 9; cell++)
+            {
+                // The first player's stones go first, any order of them gives the same board
+                if (p[cell] == player)
+                {
+                    ttt_place(&b, player - 1, cell);
+                }
+            }
+        }
+        struct ttt_result result = ttt_best_move(&s, &b, 9, 1e9);
+        nodes += result.nodes;
+        search_ms += result.ms;
+        int value = result.score > 0 ? 1 : result.score < 0 ? -1 : 0;
+        int move = TTT_TABLE_MOVE[index];
+        int after[9];
+        memcpy(after, p, sizeof(after));
+        bool keeps = move >= 0 && p[move] == 0;
+        if (keeps)
+        {
+            after[move] = b.moves % 2 + 1;
+            keeps = -TTT_TABLE_VALUE[ttt_index(after)] == TTT_TABLE_VALUE[index];
+        }
+        mismatches += value == TTT_TABLE_VALUE[index] && keeps ? 0 : 1;
+    }
+
+    long long sum = 0;
+    double start = now_ms();
+    for (int r = 0; r < TABLE_REPEATS; r++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            sum += TTT_TABLE_MOVE[ttt_index(&positions[i * 9])];
+        }
+    }
+    double table_ms = now_ms() - start;
+
+    printf("%-10i %-12i %-16.1f %-16.1f %-12.1f%s\n", n, mismatches, table_ms * 1e6 / TABLE_REPEATS / n,
+           search_ms * 1e3 / n, (double) nodes / n, sum > 0 ? "" : " (no moves!)");
+    if (mismatches > 0)
+    {
+        printf("The table disagrees with the search in %i positions, rebuild ttttable.h with make\n", mismatches);
+    }
+    ttt_search_free(&s);
+    return mismatches;
+}
+
+// Collect every position that can be reached and isn't over, each one once, as its cells: 0 for an empty cell,
+// 1 for the first player and 2 for the second
+static void ttt_walk(struct ttt_board *b, int *cells, int index, bool *seen, int *positions, int *n)
+{
+    if (seen[index] || ttt_full(b))
+    {
+        return;
+    }
+    seen[index] = true;
+    memcpy(&positions[*n * 9], cells, 9 * sizeof(int));
+    (*n)++;
+    int player = b->moves % 2;
+    for (int cell = 0; cell < 9; cell++)
+    {
+        if (cells[cell] != 0)
+        {
+            continue;
+        }
+        cells[cell] = player + 1;
+        ttt_place(b, player, cell);
+        if (!ttt_wins(b, player, cell))
+        {
+            ttt_walk(b, cells, ttt_index(cells), seen, positions, n);
+        }
+        ttt_undo(b, player, cell);
+        cells[cell] = 0;
+    }
+}
+
+// The table's index of a position, its cells are the digits of a base 3 number
+static int ttt_index(const int *cells)
+{
+    int index = 0;
+    for (int i = 8; i >= 0; i--)
+    {
+        index = index * 3 + cells[i];
+    }
+    return index;
+}
+
+// Time a second of the computer's random games from one stone in the middle. Each thread grows its own tree, so
+// the games a second should go up with the threads until they run out of cores
+static void bench_ttt_mcts(int threads, double *single)
+{
+    struct ttt_board b;
+    ttt_init(&b, MCTS_SIDE, MCTS_SIDE, 5);
+    ttt_place(&b, 0, MCTS_SIDE * MCTS_SIDE / 2);
+    struct ttt_mcts_result result = ttt_mcts_move(&b, threads, MCTS_MS, 1);
+    double per_second = result.ms > 0 ? result.playouts / (result.ms / 1000) : 0;
+    *single = threads == 1 ? per_second : *single;
+    printf("%-8i %-12lli %-16.0f %-8.2f\n", result.threads, result.playouts, per_second,
+           *single > 0 ? per_second / *single : 0);
+}
+
+// Time a microbenchmark SAMPLES times and print the mean time of an operation, its standard deviation and the
+// fastest sample
+static void run_micro(const struct micro *m, bool csv)
+{
+    double ns[SAMPLES];
+    double sum = 0;
+    double min = INFINITY;
+    for (int s = 0; s < SAMPLES; s++)
+    {
+        ns[s] = m->run(m->param, m->ops, (uint64_t) s + 1) * 1e6 / m->ops;
+        sum += ns[s];
+        min = ns[s] < min ? ns[s] : min;
+    }
+    double mean = sum / SAMPLES;
+    double squares = 0;
+    for (int s = 0; s < SAMPLES; s++)
+    {
+        squares += (ns[s] - mean) * (ns[s] - mean);
+    }
+    double stddev = sqrt(squares / (SAMPLES - 1));
+    if (csv)
+    {
+        printf("%s,%.3f,%.3f,%.3f,%i\n", m->name, mean, stddev, min, SAMPLES);
+    }
+    else
+    {
+        printf("%-24s %-12.3f %-12.3f %-12.3f\n", m->name, mean, stddev, min);
+    }
+}
+
+// Place the mines, number the cells and index the regions of an expert board, as the first click does
+static double micro_rig(int param, long long ops, uint64_t seed)
+{
+    (void) param;
+    struct rng r;
+    rng_seed(&r, seed);
+    double total = 0;
+    for (long long i = 0; i < ops; i++)
+    {
+        struct board b;
+        if (!board_init(&b, EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_MINES))
+        {
+            return NAN;
+        }
+        double start = now_ms();
+        board_rig_mines(&b, &r, EXPERT_WIDTH / 2, EXPERT_HEIGHT / 2);
+        board_index_regions(&b);
+        total += now_ms() - start;
+        board_free(&b);
+    }
+    return total;
+}
+
+// Count the adjacent mines of every cell of an expert board from its bitplane
+static double micro_counts(int param, long long ops, uint64_t seed)
+{
+    (void) param;
+    struct board b;
+    if (!board_init(&b, EXPERT_WIDTH, EXPERT_HEIGHT, 0))
+    {
+        return NAN;
+    }
+    uint64_t plane[EXPERT_HEIGHT];
+    struct rng r;
+    rng_seed(&r, seed);
+    for (int y = 0; y < EXPERT_HEIGHT; y++)
+    {
+        plane[y] = 0;
+        for (int x = 0; x < EXPERT_WIDTH; x++)
+        {
+            plane[y] |= (uint64_t) (rng_range(&r, 0, 99) < 20) << x;
+        }
+    }
+    double start = now_ms();
+    for (long long i = 0; i < ops; i++)
+    {
+        memset(b.cells, 0, b.size);
+        board_fill_counts(&b, plane);
+    }
+    double total = now_ms() - start;
+    board_free(&b);
+    return total;
+}
+
+// Open the safe cells of expert boards in a random order, counting each reveal of a closed cell as an operation.
+// Most cells are opened by the cascade of an empty cell before their turn comes, so the order is first played on
+// one board to find the cells still closed when they're revealed, and only those are timed on a second board with
+// the same mines
+static double micro_reveal(int param, long long ops, uint64_t seed)
+{
+    (void) param;
+    struct rng r;
+    rng_seed(&r, seed);
+    int cells[EXPERT_WIDTH * EXPERT_HEIGHT];
+    double total = 0;
+    long long done = 0;
+    while (done < ops)
+    {
+        struct board b, timed;
+        struct rng layout = r;
+        if (!board_init(&b, EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_MINES)
+            || !board_rig_mines(&b, &r, EXPERT_WIDTH / 2, EXPERT_HEIGHT / 2) || !board_index_regions(&b))
+        {
+            return NAN;
+        }
+        int n = 0;
+        for (int i = 0; i < b.size; i++)
+        {
+            if (!(b.cells[i] & CELL_MINE))
+            {
+                cells[n++] = i;
+            }
+        }
+        for (int i = 0; i < n; i++)
+        {
+            int j = rng_range(&r, i, n - 1);
+            int cell = cells[j];
+            cells[j] = cells[i];
+            cells[i] = cell;
+        }
+        int closed = 0;
+        for (int i = 0; i < n; i++)
+        {
+            if (!(b.cells[cells[i]] & CELL_OPENED))
+            {
+                cells[closed++] = cells[i];
+                board_reveal(&b, cells[i] % EXPERT_WIDTH, cells[i] / EXPERT_WIDTH);
+            }
+        }
+        board_free(&b);
+        if (!board_init(&timed, EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_MINES)
+            || !board_rig_mines(&timed, &layout, EXPERT_WIDTH / 2, EXPERT_HEIGHT / 2) || !board_index_regions(&timed))
+        {
+            return NAN;
+        }
+        n = closed < ops - done ? closed : (int) (ops - done);
+        double start = now_ms();
+        for (int i = 0; i < n; i++)
+        {
+            board_reveal(&timed, cells[i] % EXPERT_WIDTH, cells[i] / EXPERT_WIDTH);
+        }
+        total += now_ms() - start;
+        done += n;
+        board_free(&timed);
+    }
+    return total;
+}
+
+// Check whether a board is won, which reads two counters instead of the board
+static double micro_won(int param, long long ops, uint64_t seed)
+{
+    (void) param;
+    struct board b;
+    if (!board_init(&b, EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_MINES))
+    {
+        return NAN;
+    }
+    volatile int revealed = (int) seed;
+    long long won = 0;
+    double start = now_ms();
+    for (long long i = 0; i < ops; i++)
+    {
+        b.revealed = revealed;
+        won += board_won(&b);
+    }
+    double total = now_ms() - start;
+    board_free(&b);
+    return won >= 0 ? total : NAN;
+}
+
+// Move a snake of a given length along a cycle through the inside of the field, eating and growing whenever it
+// comes across the food
+static double micro_snake_move(int length, long long ops, uint64_t seed)
+{
+    rand_seed(seed);
+    struct snake_game g;
+    if (!game_init(&g, FILL_WIDTH + 2, FILL_HEIGHT + 2))
+    {
+        return NAN;
+    }
+    struct segment start_cell = body_head(&g.body);
+    field_release(&g.field, start_cell.x, start_cell.y);
+    body_free(&g.body);
+    int x, y;
+    cycle_cell(0, &x, &y);
+    if (!body_init(&g.body, x + 1, y + 1))
+    {
+        field_free(&g.field);
+        return NAN;
+    }
+    field_occupy(&g.field, x + 1, y + 1);
+    for (int step = 1; step < length; step++)
+    {
+        cycle_cell(step, &x, &y);
+        body_push(&g.body, x + 1, y + 1);
+        field_occupy(&g.field, x + 1, y + 1);
+    }
+
+    int step = length;
+    bool alive = true;
+    double start = now_ms();
+    for (long long i = 0; i < ops && alive; i++, step++)
+    {
+        struct segment head = body_head(&g.body);
+        cycle_cell(step, &x, &y);
+        game_turn(&g, x + 1 - head.x, y + 1 - head.y);
+        alive = game_move(&g);
+        game_clear_changes(&g);
+    }
+    double total = now_ms() - start;
+    game_free(&g);
+    return alive ? total : NAN;
+}
+
+// Pick a free cell for the food on a field that a snake of a given length takes up part of
+static double micro_spawn_food(int length, long long ops, uint64_t seed)
+{
+    rand_seed(seed);
+    struct field f;
+    if (!field_init(&f, FILL_WIDTH, FILL_HEIGHT))
+    {
+        return NAN;
+    }
+    for (int step = 0; step < length; step++)
+    {
+        int x, y;
+        cycle_cell(step, &x, &y);
+        field_occupy(&f, x, y);
+    }
+    long long food = 0;
+    double start = now_ms();
+    for (long long i = 0; i < ops; i++)
+    {
+        food += field_random_free(&f);
+    }
+    double total = now_ms() - start;
+    field_free(&f);
+    return food >= 0 ? total : NAN;
+}
+
+// Check whether the stone on a cell of a 19x19 board makes 5 in a row, as the game does after every move
+static double micro_ttt_wins(int stones, long long ops, uint64_t seed)
+{
+    struct ttt_board b;
+    struct rng r;
+    int cells[TTT_MAX_CELLS];
+    rng_seed(&r, seed);
+    random_stones(&b, stones, &r, cells);
+    long long wins = 0;
+    double start = now_ms();
+    for (long long i = 0; i < ops; i++)
+    {
+        int cell = cells[i % stones];
+        wins += ttt_wins(&b, ttt_owner(&b, cell), cell);
+    }
+    double total = now_ms() - start;
+    return wins >= 0 ? total : NAN;
+}
+
+// Place a stone and take it back on a 19x19 board, updating the score of the lines through it both times
+static double micro_ttt_place(int stones, long long ops, uint64_t seed)
+{
+    struct ttt_board b;
+    struct rng r;
+    int cells[TTT_MAX_CELLS];
+    rng_seed(&r, seed);
+    random_stones(&b, stones, &r, cells);
+    int empty[TTT_MAX_CELLS];
+    int n = 0;
+    for (int cell = 0; cell < b.width * b.height; cell++)
+    {
+        if (ttt_owner(&b, cell) < 0)
+        {
+            empty[n++] = cell;
+        }
+    }
+    double start = now_ms();
+    for (long long i = 0; i < ops; i++)
+    {
+        int cell = empty[i % n];
+        ttt_place(&b, b.moves % 2, cell);
+        ttt_undo(&b, (b.moves - 1) % 2, cell);
+    }
+    return now_ms() - start;
+}
+
+// A 19x19 board, 5 in a row, with stones on random cells, which are listed in cells
+static void random_stones(struct ttt_board *b, int stones, struct rng *r, int *cells)
+{
+    ttt_init(b, 19, 19, 5);
+    for (int i = 0; i < stones; i++)
+    {
+        int cell;
+        do
+        {
+            cell = rng_range(r, 0, b->width * b->height - 1);
+        } while (ttt_owner(b, cell) >= 0);
+        ttt_place(b, b->moves % 2, cell);
+        cells[i] = cell;
+    }
+}
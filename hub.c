@@ -0,0 +1,112 @@
+#include "hub.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "render.h"
+#include "utils.h"
+
+#define MAX_OPTIONS 16
+#define OPTIONS_SIZE 128
+#define MENU_X 2
+
+static bool choose(const struct game games[], int game_n, int *selected, int round);
+static void print_menu(const struct game games[], int game_n, int selected, int round);
+static int play(const struct game *game);
+
+// Pick a game from a menu and play as many rounds of any of them as wanted in one process. The terminal is set up
+// once, between rounds it's only left and come back to. What a game prints when it ends shows once the hub is left
+int hub(const struct game games[], int game_n)
+{
+    int selected = 0;
+    int round = 0;
+    while (choose(games, game_n, &selected, round))
+    {
+        // Every round after the first gets a seed of its own, which it prints at the end like a game played alone
+        if (round++ > 0)
+        {
+            rand_seed(rand_u64());
+        }
+        play(&games[selected]);
+    }
+    return 0;
+}
+
+// Show the menu until a game is picked, returns false to quit
+static bool choose(const struct game games[], int game_n, int *selected, int round)
+{
+    render_start(false);
+    while (true)
+    {
+        render_erase();
+        print_menu(games, game_n, *selected, round);
+        render_present();
+        int key = render_key(-1);
+        if (key == KEY_UP || key == 'w')
+        {
+            *selected = (*selected + game_n - 1) % game_n;
+        }
+        else if (key == KEY_DOWN || key == 's')
+        {
+            *selected = (*selected + 1) % game_n;
+        }
+        else if (key >= '1' && key < '1' + game_n && key <= '9')
+        {
+            *selected = key - '1';
+            break;
+        }
+        else if (key == ' ' || key == '\n' || key == KEY_ENTER)
+        {
+            break;
+        }
+        else if (key == '0' || key == 'q')
+        {
+            render_stop();
+            return false;
+        }
+    }
+    render_stop();
+    return true;
+}
+
+static void print_menu(const struct game games[], int game_n, int selected, int round)
+{
+    render_print_at(1, MENU_X, "Command Line Games");
+    for (int i = 0; i < game_n; i++)
+    {
+        render_move(3 + i, MENU_X);
+        if (i == selected)
+        {
+            render_attr_on(A_REVERSE);
+        }
+        if (i < 9)
+        {
+            render_print("%i  %s", i + 1, games[i].title);
+        }
+        else
+        {
+            render_print("   %s", games[i].title);
+        }
+        render_attr_off(A_REVERSE);
+    }
+    render_print_at(4 + game_n, MENU_X, "Arrow keys and Enter or 1-%i to play, 0 to quit", game_n < 9 ? game_n : 9);
+    if (round > 0)
+    {
+        render_print_at(5 + game_n, MENU_X, "Rounds played: %i", round);
+    }
+    render_move(3 + selected, MENU_X);
+}
+
+// Start a game with its options split at the spaces
+static int play(const struct game *game)
+{
+    char options[OPTIONS_SIZE];
+    char *argv[MAX_OPTIONS];
+    int argc = 0;
+    snprintf(options, sizeof(options), "%s", game->options);
+    for (char *option = strtok(options, " "); option != NULL && argc < MAX_OPTIONS; option = strtok(NULL, " "))
+    {
+        argv[argc++] = option;
+    }
+    return game->play(argc, argv);
+}
@@ -0,0 +1,15 @@
+#ifndef HUB_H
+#define HUB_H
+
+// A game as it's found on the command line and offered in the hub, which starts it with the options given here
+struct game
+{
+    const char *name;
+    const char *title;
+    const char *options;
+    int (*play)(int argc, char *argv[]);
+};
+
+int hub(const struct game games[], int game_n);
+
+#endif
@@ -1,40 +1,155 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 
+#include "hub.h"
 #include "minesweeper.h"
+#include "record.h"
+#include "render.h"
 #include "snake.h"
 #include "tictactoe.h"
+#include "trace.h"
+#include "utils.h"
+
+// Every game that can be played, by name on the command line or from the hub's menu. The command line starts the
+// first row with the name, the hub offers each row with its options
+static const struct game GAMES[] = {
+    { "tictactoe", "Tic Tac Toe, 2 players", "", tictactoe },
+    { "tictactoe", "Tic Tac Toe against the computer", "--ai 2", tictactoe },
+    { "tictactoe", "Five in a row on 15x15 against the computer", "--size 15 15 5 --ai 2", tictactoe },
+    { "snake", "Snake", "", snake },
+    { "snake", "Snake arena with 30 computer snakes", "--arena 30", snake },
+    { "minesweeper", "Minesweeper, beginner", "beginner", minesweeper },
+    { "minesweeper", "Minesweeper, intermediate", "intermediate", minesweeper },
+    { "minesweeper", "Minesweeper, expert", "expert", minesweeper },
+};
+#define GAME_N (int) (sizeof(GAMES) / sizeof(GAMES[0]))
 
 int main(int argc, char *argv[])
 {
     // Check for correct usage
-    if (argc != 2)
+    if (argc >= 2 && strcmp(argv[1], "--help") == 0)
     {
-        printf("Usage: ./play game_name\n\n"
+        printf("Usage: ./play [game_name] [--seed n] [--no-terminal | --ansi] [--trace file] [--record file | --replay file] [options]\n\n"
+               "Without a game name a menu of the games opens, to play any number of rounds of them\n\n"
                "Available games:\n"
                "tictactoe   - 2 players, use the keyboard to input the number of a slot\n"
+               "              --size width height k plays on a larger board with the arrow keys, k in a row wins\n"
+               "              --ai 1|2 [--depth n] [--time ms] lets the computer play the first or second player\n"
+               "              --mcts threads plays random games for its moves instead of searching, 0 uses every core\n"
                "snake       - Control using the WASD keys or the arrow keys\n"
-               "minesweeper - Right-click or enter coordinates to reveal a tile, middle-click or press Shift + F before entering coordinates to flag a tile\n");
+               "              --autopilot lets the computer play, with --headless it benchmarks the autopilot\n"
+               "              --headless ticks [--size width height] runs the simulation without a terminal as fast as possible\n"
+               "              --arena bots [--players 1-2] plays in a large arena with computer snakes, the second player uses the arrow keys\n"
+               "minesweeper - Right-click or enter coordinates to reveal a tile, middle-click or press Shift + F before entering coordinates to flag a tile\n"
+               "              Options: beginner, intermediate, expert, custom width height mines or infinite [mine_percent]\n"
+               "              --solve [--threads n] [--repeat n] file... prints the safe tiles and mine chances of saved boards\n"
+               "              --simulate games [--threads n] [difficulty] plays games without a terminal and reports the win rate\n"
+               "--seed n replays the game that printed the same seed when it ended\n"
+               "--no-terminal draws in memory instead, reading keys from standard input, and prints the last frame\n"
+               "--ansi draws with its own escape sequences, sending only what changed, and prints the bytes sent per frame\n"
+               "--trace file writes where each frame's time went as a Chrome trace, and prints the frame times at the end\n"
+               "--record file saves the seed, options and every key of the game, --replay file plays them back,\n"
+               "              as fast as possible with --no-terminal\n");
         return 1;
     }
 
-    // Select the specifeid game
-    if (strcasecmp(argv[1], "tictactoe") == 0)
+    // Take out the seed, the backends, tracing and recording, the games only see their own options. Without a game
+    // name the options are only these
+    bool has_game = argc >= 2 && strncmp(argv[1], "--", 2) != 0;
+    int first = has_game ? 2 : 1;
+    int game_argc = 0;
+    bool headless = false;
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    for (int i = first; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            rand_seed(strtoull(argv[++i], NULL, 10));
+            continue;
+        }
+        if (strcmp(argv[i], "--no-terminal") == 0)
+        {
+            render_use(&render_headless);
+            headless = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--ansi") == 0)
+        {
+            render_use(&render_ansi);
+            continue;
+        }
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            if (!trace_start(argv[++i]))
+            {
+                printf("Can't write the trace to %s\n", argv[i]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            record_path = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            replay_path = argv[++i];
+            continue;
+        }
+        argv[first + game_argc++] = argv[i];
+    }
+    if (!has_game)
     {
-        tictactoe();
+        if (game_argc > 0 || record_path != NULL || replay_path != NULL)
+        {
+            printf("Options of a game, recording and replaying need a game name, see ./play --help\n");
+            return 1;
+        }
+        return hub(GAMES, GAME_N);
     }
-    else if (strcasecmp(argv[1], "snake") == 0)
+
+    // A replay plays the game with the seed and options it was recorded with
+    char **game_argv = argv + 2;
+    if (record_path != NULL && replay_path != NULL)
     {
-        snake();
+        printf("A game can't be recorded and replayed at once\n");
+        return 1;
     }
-    else if (strcasecmp(argv[1], "minesweeper") == 0)
+    if (replay_path != NULL)
     {
-        minesweeper();
+        int recorded_argc;
+        char **recorded_argv;
+        if (!replay_start(replay_path, headless, &recorded_argc, &recorded_argv))
+        {
+            printf("Can't read the recording %s\n", replay_path);
+            return 1;
+        }
+        if (strcasecmp(recorded_argv[0], argv[1]) != 0)
+        {
+            printf("%s is a recording of %s\n", replay_path, recorded_argv[0]);
+            return 1;
+        }
+        game_argc = recorded_argc - 1;
+        game_argv = recorded_argv + 1;
     }
-    else
+    if (record_path != NULL && !record_start(record_path, game_argc + 1, argv + 1))
     {
-        printf("Game %s isn't available\n", argv[1]);
+        printf("Can't write the recording to %s\n", record_path);
         return 1;
     }
-    return 0;
+
+    // Select the specified game
+    for (int i = 0; i < GAME_N; i++)
+    {
+        if (strcasecmp(argv[1], GAMES[i].name) == 0)
+        {
+            return GAMES[i].play(game_argc, game_argv);
+        }
+    }
+    printf("Game %s isn't available\n", argv[1]);
+    return 1;
 }
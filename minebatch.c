@@ -0,0 +1,487 @@
+#include "minebatch.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mineboard.h"
+#include "minesolver.h"
+#include "utils.h"
+
+#define MAX_PRINTED 20
+#define MAX_THREADS 256
+
+// The games played by one thread, each thread has its own board and counters
+struct simulation
+{
+    int width;
+    int height;
+    int mines;
+    long long games;
+    int thread;
+    int threads;
+    uint64_t seed;
+    long long wins;
+    long long total_3bv;
+    bool ok;
+};
+
+// What was found on a board, kept from its first solve to be printed in order once every thread is done
+struct result
+{
+    bool solved;
+    struct solution found; // Only the counts, the chances of the cells aren't kept
+    int best;
+    double best_chance;
+};
+
+// The boards shared by the solving threads, each thread takes the next solve until every board is solved repeat times
+struct solver
+{
+    struct board *boards;
+    struct result *results;
+    int board_n;
+    int largest;
+    long long solves;
+    atomic_llong next;
+    atomic_bool failed;
+};
+
+static int default_threads();
+static void *solve_worker(void *arg);
+static void print_solution(int index, const struct board *b, const struct result *r);
+static void *simulate_worker(void *arg);
+static bool play_game(struct board *b, struct solution *s);
+static bool apply_rules(struct board *b);
+
+// Solve every board in the given files, printing what was found and how many boards are solved per second
+int solve_files(int argc, char *argv[])
+{
+    int threads = default_threads();
+    int repeat = 1;
+    struct board *boards = NULL;
+    int board_n = 0;
+    int board_cap = 0;
+    int largest = 1;
+    bool ok = true;
+    for (int i = 0; i < argc && ok; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = atoi(argv[++i]);
+            continue;
+        }
+
+        FILE *file = fopen(argv[i], "r");
+        if (file == NULL)
+        {
+            printf("Can't open %s\n", argv[i]);
+            ok = false;
+            break;
+        }
+        while (ok)
+        {
+            if (board_n == board_cap)
+            {
+                board_cap = board_cap == 0 ? 64 : board_cap * 2;
+                struct board *resized = realloc(boards, (size_t) board_cap * sizeof(struct board));
+                if (resized == NULL)
+                {
+                    ok = false;
+                    break;
+                }
+                boards = resized;
+            }
+            if (!board_read(&boards[board_n], file))
+            {
+                break;
+            }
+            largest = boards[board_n].size > largest ? boards[board_n].size : largest;
+            board_n++;
+        }
+        if (ok && !feof(file))
+        {
+            printf("%s: board %i is malformed\n", argv[i], board_n + 1);
+            ok = false;
+        }
+        fclose(file);
+    }
+
+    struct solver solver;
+    solver.results = NULL;
+    if (ok && (board_n == 0 || threads < 1 || repeat < 1))
+    {
+        printf("Usage: ./play minesweeper --solve [--threads n] [--repeat n] file...\n");
+        ok = false;
+    }
+    if (ok)
+    {
+        solver.results = malloc((size_t) board_n * sizeof(struct result));
+        ok = solver.results != NULL;
+    }
+
+    // The threads are started once for the whole run and share out the boards. Threads left over when there are
+    // fewer solves than threads join the solver's pool instead, which shares out the components of each board
+    if (ok)
+    {
+        solver.boards = boards;
+        solver.board_n = board_n;
+        solver.largest = largest;
+        solver.solves = (long long) board_n * repeat;
+        atomic_init(&solver.next, 0);
+        atomic_init(&solver.failed, false);
+        threads = threads > MAX_THREADS ? MAX_THREADS : threads;
+        int board_threads = threads > solver.solves ? (int) solver.solves : threads;
+        pthread_t workers[MAX_THREADS];
+        int helpers = solver_start_threads(threads - board_threads);
+        int started = 1;
+        double start = now_ms() / 1e3;
+        for (int t = 1; t < board_threads; t++)
+        {
+            if (pthread_create(&workers[t], NULL, solve_worker, &solver) != 0)
+            {
+                break;
+            }
+            started++;
+        }
+        solve_worker(&solver);
+        for (int t = 1; t < started; t++)
+        {
+            pthread_join(workers[t], NULL);
+        }
+        solver_stop_threads();
+        double elapsed = now_ms() / 1e3 - start;
+
+        if (atomic_load(&solver.failed))
+        {
+            printf("Not enough memory to solve boards of %i cells\n", largest);
+            ok = false;
+        }
+        int unsolved = 0;
+        for (int i = 0; i < board_n && ok; i++)
+        {
+            unsolved += solver.results[i].solved ? 0 : 1;
+            print_solution(i, &boards[i], &solver.results[i]);
+        }
+        if (ok)
+        {
+            printf("%lli boards in %.3fs: %.0f boards/second using %i threads, %i unsolved\n", solver.solves, elapsed,
+                   elapsed > 0 ? solver.solves / elapsed : 0, started + helpers, unsolved);
+        }
+    }
+    free(solver.results);
+
+    for (int i = 0; i < board_n; i++)
+    {
+        board_free(&boards[i]);
+    }
+    free(boards);
+    return ok ? 0 : 1;
+}
+
+// Every thread solves with its own solution, only the first solve of each board keeps its result
+static void *solve_worker(void *arg)
+{
+    struct solver *solver = arg;
+    struct solution s;
+    if (!solution_init(&s, solver->largest))
+    {
+        atomic_store(&solver->failed, true);
+        return NULL;
+    }
+    long long solve;
+    while ((solve = atomic_fetch_add(&solver->next, 1)) < solver->solves)
+    {
+        int i = (int) (solve % solver->board_n);
+        const struct board *b = &solver->boards[i];
+        bool solved = solve_board(b, &s);
+        if (solve >= solver->board_n)
+        {
+            continue;
+        }
+
+        // The safest cell is the best place to click next
+        struct result *r = &solver->results[i];
+        r->solved = solved;
+        r->found = s;
+        r->found.probability = NULL;
+        r->best = -1;
+        for (int cell = 0; cell < b->size; cell++)
+        {
+            if (!(b->cells[cell] & CELL_OPENED) && (r->best < 0 || s.probability[cell] < s.probability[r->best]))
+            {
+                r->best = cell;
+            }
+        }
+        r->best_chance = r->best >= 0 ? s.probability[r->best] : 0;
+    }
+    solution_free(&s);
+    return NULL;
+}
+
+static void print_solution(int index, const struct board *b, const struct result *r)
+{
+    const struct solution *s = &r->found;
+    if (index == MAX_PRINTED)
+    {
+        printf("...\n");
+    }
+    if (index >= MAX_PRINTED)
+    {
+        return;
+    }
+    if (!r->solved && s->complete)
+    {
+        printf("Board %i: the numbers contradict each other\n", index + 1);
+        return;
+    }
+
+    printf("Board %i: %ix%i, %i frontier cells in %i components, %i safe, %i mines", index + 1, b->width, b->height,
+           s->frontier, s->components, s->safe, s->mines);
+    if (!s->complete)
+    {
+        printf(", %i components with too many arrangements to count", s->uncounted);
+    }
+    if (r->best >= 0)
+    {
+        printf(", best move %i,%i (%.1f%% mine%s)", r->best % b->width, r->best / b->width, r->best_chance * 100,
+               s->complete ? "" : ", estimated");
+    }
+    printf("\n");
+}
+
+// Play games without a terminal, spread over threads, and report the win rate and speed
+int simulate_games(long long games, int threads, int width, int height, int mines)
+{
+    struct board test;
+    if (!board_init(&test, width, height, mines))
+    {
+        printf("Invalid board: %ix%i with %i mines\n", width, height, mines);
+        return 1;
+    }
+    board_free(&test);
+
+    threads = threads > 0 ? threads : default_threads();
+    threads = threads > MAX_THREADS ? MAX_THREADS : threads;
+    threads = threads > games ? (int) games : threads;
+    struct simulation simulations[MAX_THREADS];
+    pthread_t workers[MAX_THREADS];
+    uint64_t seed = rand_get_seed();
+
+    double start = now_ms() / 1e3;
+    int started = 1;
+    for (int t = 0; t < threads; t++)
+    {
+        struct simulation *sim = &simulations[t];
+        sim->width = width;
+        sim->height = height;
+        sim->mines = mines;
+        sim->games = games;
+        sim->thread = t;
+        sim->threads = threads;
+        sim->seed = seed;
+        sim->ok = false;
+    }
+    for (int t = 1; t < threads; t++)
+    {
+        if (pthread_create(&workers[t], NULL, simulate_worker, &simulations[t]) != 0)
+        {
+            break;
+        }
+        started++;
+    }
+    simulate_worker(&simulations[0]);
+    for (int t = 1; t < started; t++)
+    {
+        pthread_join(workers[t], NULL);
+    }
+    double elapsed = now_ms() / 1e3 - start;
+
+    if (started < threads)
+    {
+        printf("Only %i of %i threads could be started\n", started, threads);
+        return 1;
+    }
+    long long wins = 0;
+    long long total_3bv = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        if (!simulations[t].ok)
+        {
+            printf("Not enough memory to simulate a %ix%i board\n", width, height);
+            return 1;
+        }
+        wins += simulations[t].wins;
+        total_3bv += simulations[t].total_3bv;
+    }
+
+    printf("%lli games of %ix%i with %i mines in %.3fs using %i threads\n", games, width, height, mines, elapsed, threads);
+    printf("Win rate: %.2f%% (%lli wins)\n", 100.0 * wins / games, wins);
+    printf("Average 3BV: %.2f\n", (double) total_3bv / games);
+    printf("Games/second: %.0f\n", elapsed > 0 ? games / elapsed : 0);
+    printf("Seed: %llu\n", (unsigned long long) seed);
+    return 0;
+}
+
+// Every thread plays every n-th game, seeding each game from its number so results don't depend on the thread count
+static void *simulate_worker(void *arg)
+{
+    struct simulation *sim = arg;
+    struct board b;
+    struct solution s;
+    sim->wins = 0;
+    sim->total_3bv = 0;
+    if (!solution_init(&s, sim->width * sim->height))
+    {
+        return NULL;
+    }
+    for (long long game = sim->thread; game < sim->games; game += sim->threads)
+    {
+        struct rng r;
+        rng_seed(&r, rng_mix(sim->seed, game));
+        if (!board_init(&b, sim->width, sim->height, sim->mines))
+        {
+            solution_free(&s);
+            return NULL;
+        }
+        if (!board_rig_mines(&b, &r, sim->width / 2, sim->height / 2))
+        {
+            board_free(&b);
+            solution_free(&s);
+            return NULL;
+        }
+        int clicks = board_3bv(&b);
+        if (clicks < 0)
+        {
+            board_free(&b);
+            solution_free(&s);
+            return NULL;
+        }
+        sim->total_3bv += clicks;
+        sim->wins += play_game(&b, &s) ? 1 : 0;
+        board_free(&b);
+    }
+    solution_free(&s);
+    sim->ok = true;
+    return NULL;
+}
+
+// Open the middle cell, then follow the numbers. When they aren't enough, ask the solver for
+// the safe cells, or the cell least likely to be a mine
+static bool play_game(struct board *b, struct solution *s)
+{
+    board_reveal(b, b->width / 2, b->height / 2);
+    while (!b->exploded && !board_won(b))
+    {
+        if (apply_rules(b))
+        {
+            continue;
+        }
+
+        // A board with a component too large to count still has its certain cells and estimates
+        int guess = -1;
+        bool solved = solve_board(b, s) || !s->complete;
+        bool progress = false;
+        for (int i = 0; i < b->size; i++)
+        {
+            if (b->cells[i] & (CELL_OPENED | CELL_FLAG))
+            {
+                continue;
+            }
+            if (!solved)
+            {
+                guess = guess < 0 ? i : guess;
+            }
+            else if (s->probability[i] == 0)
+            {
+                board_reveal(b, i % b->width, i / b->width);
+                progress = true;
+            }
+            else if (s->probability[i] == 1)
+            {
+                board_toggle_flag(b, i % b->width, i / b->width);
+            }
+            else if (guess < 0 || s->probability[i] < s->probability[guess])
+            {
+                guess = i;
+            }
+        }
+        if (!progress && guess >= 0)
+        {
+            board_reveal(b, guess % b->width, guess / b->width);
+        }
+    }
+    return board_won(b);
+}
+
+// Flag the unopened cells around a number that needs all of them, or open them when its mines are all flagged
+static bool apply_rules(struct board *b)
+{
+    bool progress = false;
+    for (int y = 0; y < b->height; y++)
+    {
+        for (int x = 0; x < b->width; x++)
+        {
+            uint8_t cell = *board_cell(b, x, y);
+            int mines = cell & CELL_COUNT_MASK;
+            if ((cell & (CELL_OPENED | CELL_MINE)) != CELL_OPENED || mines == 0)
+            {
+                continue;
+            }
+
+            int flags = 0;
+            int unopened = 0;
+            for (int a_y = y - 1; a_y <= y + 1; a_y++)
+            {
+                for (int a_x = x - 1; a_x <= x + 1; a_x++)
+                {
+                    if (board_contains(b, a_x, a_y))
+                    {
+                        uint8_t adjacent = *board_cell(b, a_x, a_y);
+                        flags += (adjacent & CELL_FLAG) ? 1 : 0;
+                        unopened += (adjacent & (CELL_OPENED | CELL_FLAG)) ? 0 : 1;
+                    }
+                }
+            }
+            if (unopened == 0 || (flags != mines && flags + unopened != mines))
+            {
+                continue;
+            }
+
+            for (int a_y = y - 1; a_y <= y + 1; a_y++)
+            {
+                for (int a_x = x - 1; a_x <= x + 1; a_x++)
+                {
+                    if (!board_contains(b, a_x, a_y) || (*board_cell(b, a_x, a_y) & (CELL_OPENED | CELL_FLAG)))
+                    {
+                        continue;
+                    }
+                    if (flags == mines)
+                    {
+                        board_reveal(b, a_x, a_y);
+                    }
+                    else
+                    {
+                        board_toggle_flag(b, a_x, a_y);
+                    }
+                }
+            }
+            progress = true;
+        }
+    }
+    return progress;
+}
+
+static int default_threads()
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int) cores : 1;
+}
@@ -0,0 +1,7 @@
+#ifndef MINEBATCH_H
+#define MINEBATCH_H
+
+int solve_files(int argc, char *argv[]);
+int simulate_games(long long games, int threads, int width, int height, int mines);
+
+#endif
@@ -0,0 +1,594 @@
+#include "mineboard.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+#define ADJACENT_N 8
+#define SAFE_N 9 // The first click and its neighbours
+
+// Whether 8 cells can be written as one word, their bytes have to be in the same order as the word's
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define WORD_WRITES false
+#else
+#define WORD_WRITES true
+#endif
+#define LINE_SIZE 4096
+
+static void column_sum(const uint64_t *above, const uint64_t *row, const uint64_t *below, int w, uint64_t *low,
+                       uint64_t *high);
+static uint64_t spread_bits(uint64_t bits);
+static bool is_empty(uint8_t cell);
+static bool index_regions(struct board *b);
+static int find_root(int *parent, int i);
+static void join(int *parent, int a, int b);
+static void open_cell(struct board *b, int i);
+
+// Allocate an empty board, there has to be at least one safe cell
+bool board_init(struct board *b, int width, int height, int mines)
+{
+    if (width < 1 || height < 1 || (long long) width * height > INT_MAX)
+    {
+        return false;
+    }
+    if (mines < 0 || mines >= width * height)
+    {
+        return false;
+    }
+
+    b->cells = calloc((size_t) width * height, sizeof(uint8_t));
+    if (b->cells == NULL)
+    {
+        return false;
+    }
+    b->width = width;
+    b->height = height;
+    b->size = width * height;
+    b->mines = mines;
+    b->region = NULL;
+    b->region_start = NULL;
+    b->region_cells = NULL;
+    b->regions = 0;
+    b->rigged = false;
+    b->revealed = 0;
+    b->flags = 0;
+    b->correct_flags = 0;
+    b->exploded = false;
+    return true;
+}
+
+void board_free(struct board *b)
+{
+    free(b->cells);
+    free(b->region);
+    free(b->region_start);
+    free(b->region_cells);
+    b->cells = NULL;
+    b->region = NULL;
+    b->region_start = NULL;
+    b->region_cells = NULL;
+}
+
+// Place the mines randomly, keeping the first click and its neighbours safe when there is room. Floyd's algorithm
+// picks every mine with one random number whatever the density, using a bitplane of the mines as the set of picked
+// cells. The bitplane is 8 times smaller than the board so it stays in the cache
+bool board_rig_mines(struct board *b, struct rng *r, int safe_x, int safe_y)
+{
+    int stride = board_plane_stride(b);
+    uint64_t *plane = calloc((size_t) stride * b->height, sizeof(uint64_t));
+    if (plane == NULL)
+    {
+        return false;
+    }
+
+    // The safe cells in increasing order, candidates skip over them
+    int safe[SAFE_N];
+    int safe_n = 0;
+    for (int a_y = safe_y - 1; a_y <= safe_y + 1; a_y++)
+    {
+        for (int a_x = safe_x - 1; a_x <= safe_x + 1; a_x++)
+        {
+            if (board_contains(b, a_x, a_y))
+            {
+                safe[safe_n++] = a_y * b->width + a_x;
+            }
+        }
+    }
+    if (b->mines > b->size - safe_n)
+    {
+        safe[0] = safe_y * b->width + safe_x;
+        safe_n = board_contains(b, safe_x, safe_y) ? 1 : 0;
+    }
+
+    // On dense boards it's quicker to fill every candidate and pick the safe cells instead
+    int candidates = b->size - safe_n;
+    bool pick_safe = b->mines > candidates / 2;
+    int picks = pick_safe ? candidates - b->mines : b->mines;
+    if (pick_safe)
+    {
+        for (int y = 0; y < b->height; y++)
+        {
+            for (int x = 0; x < b->width; x += 64)
+            {
+                plane[y * stride + x / 64] = b->width - x >= 64 ? ~0ULL : (1ULL << (b->width - x)) - 1;
+            }
+        }
+        for (int s = 0; s < safe_n; s++)
+        {
+            int x = safe[s] % b->width;
+            plane[safe[s] / b->width * stride + x / 64] &= ~(1ULL << (x % 64));
+        }
+    }
+    for (int j = candidates - picks; j < candidates; j++)
+    {
+        int pick = rng_range(r, 0, j);
+        for (int k = 0; k < 2; k++)
+        {
+            int i = k == 0 ? pick : j;
+            for (int s = 0; s < safe_n && safe[s] <= i; s++)
+            {
+                i++;
+            }
+            int x = i % b->width;
+            uint64_t *word = &plane[i / b->width * stride + x / 64];
+            uint64_t bit = 1ULL << (x % 64);
+            if (((*word & bit) != 0) == pick_safe)
+            {
+                *word ^= bit;
+                break;
+            }
+        }
+    }
+
+    board_fill_counts(b, plane);
+    free(plane);
+    b->rigged = true;
+    return true;
+}
+
+// Set the mine bits of the board from a bitplane and fill in every cell's number of adjacent mines.
+// Whole rows are counted 64 cells at a time: the mines of the 3 rows in each column are added up with a full adder
+// on the words, then the columns on both sides are added to the 2 rows around each cell, giving the 4 bits of each
+// count in 4 words. Those bits are spread out into bytes 8 cells at a time
+void board_fill_counts(struct board *b, const uint64_t *plane)
+{
+    int stride = board_plane_stride(b);
+    for (int y = 0; y < b->height; y++)
+    {
+        const uint64_t *above = y > 0 ? &plane[(y - 1) * stride] : NULL;
+        const uint64_t *row = &plane[y * stride];
+        const uint64_t *below = y + 1 < b->height ? &plane[(y + 1) * stride] : NULL;
+        uint8_t *cells = &b->cells[(size_t) y * b->width];
+
+        // Column sums of the previous, current and next word
+        uint64_t low[3] = { 0, 0, 0 };
+        uint64_t high[3] = { 0, 0, 0 };
+        column_sum(above, row, below, 0, &low[1], &high[1]);
+        for (int w = 0; w < stride; w++)
+        {
+            column_sum(above, row, below, w + 1 < stride ? w + 1 : -1, &low[2], &high[2]);
+
+            // The columns to the left and right of every cell, and the cells above and below it
+            uint64_t left_low = low[1] << 1 | low[0] >> 63;
+            uint64_t left_high = high[1] << 1 | high[0] >> 63;
+            uint64_t right_low = low[1] >> 1 | low[2] << 63;
+            uint64_t right_high = high[1] >> 1 | high[2] << 63;
+            uint64_t up = above != NULL ? above[w] : 0;
+            uint64_t down = below != NULL ? below[w] : 0;
+            uint64_t middle_low = up ^ down;
+            uint64_t middle_high = up & down;
+
+            // Add the three 2-bit numbers
+            uint64_t bit0 = left_low ^ right_low ^ middle_low;
+            uint64_t carry0 = (left_low & right_low) | (middle_low & (left_low ^ right_low));
+            uint64_t sum1 = left_high ^ right_high ^ middle_high;
+            uint64_t carry1 = (left_high & right_high) | (middle_high & (left_high ^ right_high));
+            uint64_t bit1 = sum1 ^ carry0;
+            uint64_t carry2 = sum1 & carry0;
+            uint64_t bit2 = carry1 ^ carry2;
+            uint64_t bit3 = carry1 & carry2;
+
+            int cell_n = b->width - w * 64 < 64 ? b->width - w * 64 : 64;
+            for (int k = 0; k < cell_n; k += 8)
+            {
+                uint64_t bytes = spread_bits(bit0 >> k) | spread_bits(bit1 >> k) << 1 | spread_bits(bit2 >> k) << 2 |
+                                 spread_bits(bit3 >> k) << 3 | spread_bits(row[w] >> k) << 4;
+                uint8_t *out = &cells[w * 64 + k];
+                if (WORD_WRITES && cell_n - k >= 8)
+                {
+                    uint64_t current;
+                    memcpy(&current, out, sizeof(current));
+                    current |= bytes;
+                    memcpy(out, &current, sizeof(current));
+                    b->correct_flags += __builtin_popcountll(current & current >> 1 & 0x1010101010101010ULL);
+                    continue;
+                }
+                for (int c = 0; c < cell_n - k && c < 8; c++)
+                {
+                    out[c] |= (uint8_t) (bytes >> (c * 8));
+                    b->correct_flags += (out[c] & (CELL_MINE | CELL_FLAG)) == (CELL_MINE | CELL_FLAG) ? 1 : 0;
+                }
+            }
+
+            low[0] = low[1];
+            high[0] = high[1];
+            low[1] = low[2];
+            high[1] = high[2];
+        }
+    }
+}
+
+// Find the empty regions unless they're already known. Placing the mines leaves them to the first cascade, since
+// on a huge board indexing takes much longer than the placing. Returns false if there isn't the memory for them
+bool board_index_regions(struct board *b)
+{
+    if (b->region_cells != NULL)
+    {
+        return true;
+    }
+    if (index_regions(b))
+    {
+        return true;
+    }
+    free(b->region);
+    free(b->region_start);
+    b->region = NULL;
+    b->region_start = NULL;
+    b->regions = 0;
+    return false;
+}
+
+// The least number of clicks that clears the board: one for every empty region,
+// and one for every numbered cell that isn't opened by an empty region. Returns -1 without the memory to find them
+int board_3bv(struct board *b)
+{
+    if (!board_index_regions(b))
+    {
+        return -1;
+    }
+    int clicks = b->regions;
+    for (int y = 0; y < b->height; y++)
+    {
+        for (int x = 0; x < b->width; x++)
+        {
+            uint8_t cell = *board_cell(b, x, y);
+            if ((cell & CELL_MINE) || (cell & CELL_COUNT_MASK) == 0)
+            {
+                continue;
+            }
+            bool next_to_region = false;
+            for (int a_y = y - 1; a_y <= y + 1 && !next_to_region; a_y++)
+            {
+                for (int a_x = x - 1; a_x <= x + 1 && !next_to_region; a_x++)
+                {
+                    next_to_region = board_contains(b, a_x, a_y) && b->region[a_y * b->width + a_x] >= 0;
+                }
+            }
+            clicks += next_to_region ? 0 : 1;
+        }
+    }
+    return clicks;
+}
+
+// Add up the mines of the 3 rows in every column of a word, giving the low and high bit of each sum
+static void column_sum(const uint64_t *above, const uint64_t *row, const uint64_t *below, int w, uint64_t *low,
+                       uint64_t *high)
+{
+    uint64_t up = above != NULL && w >= 0 ? above[w] : 0;
+    uint64_t middle = w >= 0 ? row[w] : 0;
+    uint64_t down = below != NULL && w >= 0 ? below[w] : 0;
+    *low = up ^ middle ^ down;
+    *high = (up & middle) | (down & (up ^ middle));
+}
+
+// Move the lowest 8 bits into the lowest bit of 8 bytes: copy them into every byte, keep bit k in byte k,
+// then turn every byte that isn't zero into a 1
+static uint64_t spread_bits(uint64_t bits)
+{
+    uint64_t copies = (bits & 0xFF) * 0x0101010101010101ULL;
+    return ((copies & 0x8040201008040201ULL) + 0x7F7F7F7F7F7F7F7FULL) >> 7 & 0x0101010101010101ULL;
+}
+
+// No mine in or around the cell, whether or not it is flagged
+static bool is_empty(uint8_t cell)
+{
+    return (cell & (CELL_MINE | CELL_COUNT_MASK)) == 0;
+}
+
+// Open a cell, or the whole region if it's empty, returns true if a mine was hit. Without the memory to find the
+// regions only the cell itself opens
+bool board_reveal(struct board *b, int x, int y)
+{
+    if (!board_contains(b, x, y))
+    {
+        return false;
+    }
+    int i = y * b->width + x;
+    if (b->cells[i] & (CELL_OPENED | CELL_FLAG))
+    {
+        return false;
+    }
+    if (b->cells[i] & CELL_MINE)
+    {
+        b->cells[i] |= CELL_OPENED;
+        b->exploded = true;
+        return true;
+    }
+
+    if (!is_empty(b->cells[i]) || !board_index_regions(b))
+    {
+        open_cell(b, i);
+        return false;
+    }
+    int region = b->region[i];
+    for (int j = b->region_start[region]; j < b->region_start[region + 1]; j++)
+    {
+        open_cell(b, b->region_cells[j]);
+    }
+    return false;
+}
+
+// Add or remove a flag on an unopened cell
+void board_toggle_flag(struct board *b, int x, int y)
+{
+    if (!board_contains(b, x, y))
+    {
+        return;
+    }
+    uint8_t *cell = board_cell(b, x, y);
+    if (*cell & CELL_OPENED)
+    {
+        return;
+    }
+
+    *cell ^= CELL_FLAG;
+    int change = (*cell & CELL_FLAG) ? 1 : -1;
+    b->flags += change;
+    if (*cell & CELL_MINE)
+    {
+        b->correct_flags += change;
+    }
+}
+
+// Read a partially played board: a "width height mines" line followed by a row of characters for every row of
+// cells. '#' is unopened, 'F' is flagged, '.' or a digit is opened and '*' is an opened mine. Lines starting with ';'
+// are skipped. Returns false at the end of the file or if the board is malformed
+bool board_read(struct board *b, FILE *file)
+{
+    char line[LINE_SIZE];
+    int width, height, mines;
+    do
+    {
+        if (fgets(line, LINE_SIZE, file) == NULL)
+        {
+            return false;
+        }
+    } while (line[0] == ';' || line[strspn(line, " \t\r\n")] == '\0');
+    if (sscanf(line, "%i %i %i", &width, &height, &mines) != 3 || width > LINE_SIZE - 2)
+    {
+        return false;
+    }
+    if (!board_init(b, width, height, mines))
+    {
+        return false;
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        if (fgets(line, LINE_SIZE, file) == NULL || (int) strcspn(line, "\r\n") != width)
+        {
+            board_free(b);
+            return false;
+        }
+        for (int x = 0; x < width; x++)
+        {
+            uint8_t *cell = board_cell(b, x, y);
+            char ch = line[x];
+            if (ch == 'F')
+            {
+                *cell = CELL_FLAG;
+                b->flags++;
+            }
+            else if (ch == '*')
+            {
+                *cell = CELL_OPENED | CELL_MINE;
+                b->exploded = true;
+            }
+            else if (ch == '.' || (ch >= '0' && ch <= '8'))
+            {
+                *cell = CELL_OPENED | (ch == '.' ? 0 : ch - '0');
+                b->revealed++;
+            }
+            else if (ch != '#')
+            {
+                board_free(b);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Label the empty regions with union-find, then list each region's cells together with the numbered cells around it
+static bool index_regions(struct board *b)
+{
+    int width = b->width;
+    b->region = malloc((size_t) b->size * sizeof(int));
+    if (b->region == NULL)
+    {
+        return false;
+    }
+
+    // Join every empty cell to the empty cells before it, a parent always comes before its children.
+    // The cell above touches both of the other cells above and the cell to the left, so when it's empty they
+    // are already joined to it, and the cell to the left is already joined to the one above it
+    int *parent = b->region;
+    const uint8_t *cells = b->cells;
+    for (int y = 0; y < b->height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int i = y * width + x;
+            if (!is_empty(cells[i]))
+            {
+                parent[i] = -1;
+                continue;
+            }
+            parent[i] = i;
+            bool left = x > 0 && is_empty(cells[i - 1]);
+            if (y > 0 && is_empty(cells[i - width]))
+            {
+                join(parent, i, i - width);
+                continue;
+            }
+            if (y > 0 && x < width - 1 && is_empty(cells[i - width + 1]))
+            {
+                join(parent, i, i - width + 1);
+            }
+            if (left)
+            {
+                join(parent, i, i - 1);
+            }
+            else if (y > 0 && x > 0 && is_empty(cells[i - width - 1]))
+            {
+                join(parent, i, i - width - 1);
+            }
+        }
+    }
+
+    // Replace parents with region numbers, a parent has always been numbered before its children
+    b->regions = 0;
+    for (int i = 0; i < b->size; i++)
+    {
+        if (parent[i] == i)
+        {
+            b->region[i] = b->regions++;
+        }
+        else if (parent[i] >= 0)
+        {
+            b->region[i] = b->region[parent[i]];
+        }
+    }
+
+    // Count the cells of each region, then fill them in
+    b->region_start = calloc((size_t) b->regions + 1, sizeof(int));
+    if (b->region_start == NULL)
+    {
+        return false;
+    }
+    int *start = b->region_start;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int y = 0; y < b->height; y++)
+        {
+            int top = y > 0 ? y - 1 : y;
+            int bottom = y < b->height - 1 ? y + 1 : y;
+            for (int x = 0; x < width; x++)
+            {
+                int i = y * width + x;
+                if (cells[i] & CELL_MINE)
+                {
+                    continue;
+                }
+
+                // Numbered cells can border several regions
+                int found[ADJACENT_N];
+                int found_n = 0;
+                if (b->region[i] >= 0)
+                {
+                    found[found_n++] = b->region[i];
+                }
+                else if (cells[i] & CELL_COUNT_MASK)
+                {
+                    int left = x > 0 ? x - 1 : x;
+                    int right = x < width - 1 ? x + 1 : x;
+                    for (int a_y = top; a_y <= bottom; a_y++)
+                    {
+                        for (int a_x = left; a_x <= right; a_x++)
+                        {
+                            int j = a_y * width + a_x;
+                            int region = is_empty(cells[j]) ? b->region[j] : -1;
+                            bool is_new = region >= 0;
+                            for (int k = 0; k < found_n && is_new; k++)
+                            {
+                                is_new = found[k] != region;
+                            }
+                            if (is_new)
+                            {
+                                found[found_n++] = region;
+                            }
+                        }
+                    }
+                }
+
+                for (int j = 0; j < found_n; j++)
+                {
+                    if (pass == 0)
+                    {
+                        start[found[j] + 1]++;
+                    }
+                    else
+                    {
+                        b->region_cells[start[found[j]]++] = i;
+                    }
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            for (int r = 0; r < b->regions; r++)
+            {
+                start[r + 1] += start[r];
+            }
+            b->region_cells = malloc((size_t) (start[b->regions] > 0 ? start[b->regions] : 1) * sizeof(int));
+            if (b->region_cells == NULL)
+            {
+                return false;
+            }
+        }
+    }
+
+    // Filling moved every start to the start of the next region
+    for (int r = b->regions; r > 0; r--)
+    {
+        start[r] = start[r - 1];
+    }
+    start[0] = 0;
+    return true;
+}
+
+static int find_root(int *parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// Merge two sets, keeping the lowest index as the root
+static void join(int *parent, int a, int b)
+{
+    int root_a = find_root(parent, a);
+    int root_b = find_root(parent, b);
+    if (root_a < root_b)
+    {
+        parent[root_b] = root_a;
+    }
+    else if (root_b < root_a)
+    {
+        parent[root_a] = root_b;
+    }
+}
+
+static void open_cell(struct board *b, int i)
+{
+    if (!(b->cells[i] & (CELL_OPENED | CELL_FLAG)))
+    {
+        b->cells[i] |= CELL_OPENED;
+        b->revealed++;
+    }
+}
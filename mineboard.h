@@ -0,0 +1,70 @@
+#ifndef MINEBOARD_H
+#define MINEBOARD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "utils.h"
+
+// Every cell is packed into a single byte
+#define CELL_COUNT_MASK 0x0F // Number of adjacent mines (0-8)
+#define CELL_MINE 0x10
+#define CELL_FLAG 0x20
+#define CELL_OPENED 0x40
+
+struct board
+{
+    int width;
+    int height;
+    int size;
+    int mines;
+    uint8_t *cells;
+
+    // Every empty cell belongs to a region, which lists the empty cells and their numbered border
+    // so a click on an empty cell opens the whole region at once. They're found by the first click that needs them
+    int *region;        // Region of each cell, -1 for cells that aren't empty, NULL until the regions are found
+    int *region_start;  // Where each region's cells start in region_cells
+    int *region_cells;
+    int regions;
+    bool rigged; // Mines are placed on the first click
+
+    // Running counters, kept up to date so the game never has to scan the board
+    int revealed;      // Opened safe cells
+    int flags;         // Flags currently placed
+    int correct_flags; // Flags placed on mines
+    bool exploded;
+};
+
+bool board_init(struct board *b, int width, int height, int mines);
+void board_free(struct board *b);
+bool board_rig_mines(struct board *b, struct rng *r, int safe_x, int safe_y);
+void board_fill_counts(struct board *b, const uint64_t *plane);
+bool board_index_regions(struct board *b);
+int board_3bv(struct board *b);
+bool board_reveal(struct board *b, int x, int y);
+void board_toggle_flag(struct board *b, int x, int y);
+bool board_read(struct board *b, FILE *file);
+
+static inline uint8_t *board_cell(const struct board *b, int x, int y)
+{
+    return &b->cells[y * b->width + x];
+}
+
+// Words per row of a mine bitplane, one bit per cell with every row starting on a new word
+static inline int board_plane_stride(const struct board *b)
+{
+    return (b->width + 63) / 64;
+}
+
+static inline bool board_contains(const struct board *b, int x, int y)
+{
+    return x >= 0 && y >= 0 && x < b->width && y < b->height;
+}
+
+// All safe cells are open
+static inline bool board_won(const struct board *b)
+{
+    return !b->exploded && b->revealed == b->size - b->mines;
+}
+
+#endif
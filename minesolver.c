@@ -0,0 +1,1121 @@
+#include "minesolver.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ADJACENT_N 8
+#define MAX_COMPONENT_VARS 256
+#define NODE_LIMIT (1LL << 24) // Search nodes per component before giving up
+#define MAX_SLOTS 32            // Numbers that can be partly assigned at once when counting by layers
+#define MAX_LAYER_STATES 4096
+#define MAX_LAYER_BYTES (64 << 20) // Memory for the states of every layer of a component before backtracking instead
+#define STATE_TABLE_SIZE (MAX_LAYER_STATES * 2)
+#define MAX_POOL_THREADS 256
+#define POOL_MIN_VARS 24 // Smaller components are counted by the caller, handing them out costs more than counting
+
+// A group of frontier cells that share numbers, independent from every other group
+struct component
+{
+    int var_n;
+    int *cells;                  // Cell of each variable, in the order they are enumerated
+    int (*var_cons)[ADJACENT_N]; // Numbers each variable is next to
+    int *var_con_n;
+    int con_n;
+    int *con_value;     // Mines around each number that are still unknown
+    int *con_size;      // Unknown cells around each number
+    double *counts;     // Arrangements of the component by number of mines
+    double *var_counts; // Arrangements with the variable as a mine by number of mines, var_n + 1 per variable
+    long long nodes;
+    bool complete;
+};
+
+struct search
+{
+    struct component *c;
+    char *assigned;
+    int *con_mines;
+    int *con_unassigned;
+};
+
+// The large components of one board, handed out one at a time to the pool's threads and the caller
+struct task
+{
+    struct component **components;
+    int component_n;
+    int taken;
+    int counted;
+    struct task *next;
+};
+
+typedef unsigned __int128 state_t;
+
+// The distinct states after assigning the first variables, with the ways of reaching each one and of completing it
+struct layer
+{
+    int state_n;
+    int state_cap;
+    state_t *states; // Mines around each partly assigned number, 4 bits per slot
+    int (*next)[2];   // State reached by making the next variable safe or a mine, -1 if that breaks a number
+    double *before;   // Arrangements of the previous variables by number of mines, var_n + 1 per state
+    double *after;    // Arrangements of the remaining variables by number of mines, var_n + 1 per state
+};
+
+static bool build_components(const struct board *b, int *var_of, int *var_cell, int var_n,
+                             struct component **components, int *component_n);
+static bool count_arrangements(struct component *c);
+static bool count_by_layers(struct component *c);
+static int add_state(struct layer *l, state_t state, int *table, int len);
+static void enumerate(struct search *s, int depth, int mines);
+static bool combine(const struct board *b, struct solution *s, struct component *components, int component_n,
+                    int unknown, int known_mines, int var_n);
+static void estimate(const struct board *b, struct solution *s, const struct component *components, int component_n,
+                     int unknown, int known_mines);
+static double *convolve(const double *a, int a_len, const double *b, int b_len, int max_len, int *len);
+static int find_root(int *parent, int i);
+static void free_components(struct component *components, int component_n);
+static void count_components(struct component *components, int component_n);
+static void *pool_worker(void *arg);
+static void work_on(struct task *t);
+
+// Threads kept from solver_start_threads() to solver_stop_threads() that count the large components of the boards
+// being solved, so the components of one board are counted on several cores. Boards solved by several threads at
+// once share the pool, and the tasks with components left to take are kept in a list
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static struct task *pool_tasks;
+static pthread_t pool_threads[MAX_POOL_THREADS];
+static int pool_thread_n;
+static bool pool_stopping;
+
+bool solution_init(struct solution *s, int size)
+{
+    s->probability = malloc((size_t) size * sizeof(double));
+    return s->probability != NULL;
+}
+
+void solution_free(struct solution *s)
+{
+    free(s->probability);
+    s->probability = NULL;
+}
+
+// Start threads that help every solve_board() call count its components until solver_stop_threads().
+// Returns how many could be started
+int solver_start_threads(int threads)
+{
+    solver_stop_threads();
+    pool_stopping = false;
+    threads = threads > MAX_POOL_THREADS ? MAX_POOL_THREADS : threads;
+    while (pool_thread_n < threads && pthread_create(&pool_threads[pool_thread_n], NULL, pool_worker, NULL) == 0)
+    {
+        pool_thread_n++;
+    }
+    return pool_thread_n;
+}
+
+void solver_stop_threads()
+{
+    pthread_mutex_lock(&pool_lock);
+    pool_stopping = true;
+    pthread_cond_broadcast(&pool_work);
+    pthread_mutex_unlock(&pool_lock);
+    for (int t = 0; t < pool_thread_n; t++)
+    {
+        pthread_join(pool_threads[t], NULL);
+    }
+    pool_thread_n = 0;
+}
+
+// Find the chance of every unopened cell being a mine, using only the numbers that are visible to the player.
+// Returns false if the numbers contradict each other or a component couldn't be counted. In that case the
+// certain cells of the other components are still found, and the rest only get an estimate
+bool solve_board(const struct board *b, struct solution *s)
+{
+    s->safe = 0;
+    s->mines = 0;
+    s->frontier = 0;
+    s->components = 0;
+    s->uncounted = 0;
+    s->complete = true;
+
+    int *var_of = malloc((size_t) b->size * sizeof(int));
+    int *var_cell = malloc((size_t) b->size * sizeof(int));
+    if (var_of == NULL || var_cell == NULL)
+    {
+        free(var_of);
+        free(var_cell);
+        return false;
+    }
+
+    // Every unopened cell next to a number is a variable, flags are only the player's guess so they are ignored
+    int var_n = 0;
+    int unknown = 0;
+    int known_mines = 0;
+    for (int i = 0; i < b->size; i++)
+    {
+        var_of[i] = -1;
+        if (b->cells[i] & CELL_OPENED)
+        {
+            known_mines += (b->cells[i] & CELL_MINE) ? 1 : 0;
+        }
+        else
+        {
+            unknown++;
+        }
+    }
+    for (int i = 0; i < b->size; i++)
+    {
+        s->probability[i] = -1;
+        if ((b->cells[i] & (CELL_OPENED | CELL_MINE)) != CELL_OPENED || (b->cells[i] & CELL_COUNT_MASK) == 0)
+        {
+            continue;
+        }
+        int x = i % b->width;
+        int y = i / b->width;
+        for (int a_y = y - 1; a_y <= y + 1; a_y++)
+        {
+            for (int a_x = x - 1; a_x <= x + 1; a_x++)
+            {
+                int a = a_y * b->width + a_x;
+                if (board_contains(b, a_x, a_y) && !(b->cells[a] & CELL_OPENED) && var_of[a] < 0)
+                {
+                    var_of[a] = var_n;
+                    var_cell[var_n++] = a;
+                }
+            }
+        }
+    }
+    s->frontier = var_n;
+
+    struct component *components = NULL;
+    int component_n = 0;
+    bool solved = build_components(b, var_of, var_cell, var_n, &components, &component_n);
+    free(var_of);
+    free(var_cell);
+    if (!solved)
+    {
+        free_components(components, component_n);
+        return false;
+    }
+    s->components = component_n;
+
+    count_components(components, component_n);
+    for (int c = 0; c < component_n; c++)
+    {
+        s->uncounted += components[c].complete ? 0 : 1;
+    }
+    s->complete = s->uncounted == 0;
+    if (s->complete)
+    {
+        solved = combine(b, s, components, component_n, unknown, known_mines, var_n);
+    }
+    else
+    {
+        estimate(b, s, components, component_n, unknown, known_mines);
+        solved = false;
+    }
+    free_components(components, component_n);
+    return solved;
+}
+
+// Group the variables into components with union-find and order each one so neighbours are enumerated together
+static bool build_components(const struct board *b, int *var_of, int *var_cell, int var_n,
+                             struct component **components, int *component_n)
+{
+    // Every number touching a variable is a constraint
+    int con_n = 0;
+    for (int i = 0; i < b->size; i++)
+    {
+        if ((b->cells[i] & (CELL_OPENED | CELL_MINE)) == CELL_OPENED && (b->cells[i] & CELL_COUNT_MASK) > 0)
+        {
+            con_n++;
+        }
+    }
+    int (*con_vars)[ADJACENT_N] = malloc((size_t) (con_n > 0 ? con_n : 1) * sizeof(*con_vars));
+    int *con_size = malloc((size_t) (con_n > 0 ? con_n : 1) * sizeof(int));
+    int *con_value = malloc((size_t) (con_n > 0 ? con_n : 1) * sizeof(int));
+    int *con_local = malloc((size_t) (con_n > 0 ? con_n : 1) * sizeof(int));
+    int *parent = malloc((size_t) (var_n > 0 ? var_n : 1) * sizeof(int));
+    int *component_of = malloc((size_t) (var_n > 0 ? var_n : 1) * sizeof(int));
+    int *local = malloc((size_t) (var_n > 0 ? var_n : 1) * sizeof(int));
+    int *queue = malloc((size_t) (var_n > 0 ? var_n : 1) * sizeof(int));
+    int (*var_cons)[ADJACENT_N] = malloc((size_t) (var_n > 0 ? var_n : 1) * sizeof(*var_cons));
+    int *var_con_n = calloc((size_t) (var_n > 0 ? var_n : 1), sizeof(int));
+    bool ok = con_vars != NULL && con_size != NULL && con_value != NULL && con_local != NULL && parent != NULL &&
+              component_of != NULL && local != NULL && queue != NULL && var_cons != NULL && var_con_n != NULL;
+
+    for (int v = 0; v < var_n && ok; v++)
+    {
+        parent[v] = v;
+    }
+
+    // Fill in the constraints, joining the variables of each one
+    con_n = 0;
+    for (int i = 0; i < b->size && ok; i++)
+    {
+        if ((b->cells[i] & (CELL_OPENED | CELL_MINE)) != CELL_OPENED || (b->cells[i] & CELL_COUNT_MASK) == 0)
+        {
+            continue;
+        }
+        int x = i % b->width;
+        int y = i / b->width;
+        int value = b->cells[i] & CELL_COUNT_MASK;
+        int size = 0;
+        for (int a_y = y - 1; a_y <= y + 1; a_y++)
+        {
+            for (int a_x = x - 1; a_x <= x + 1; a_x++)
+            {
+                if (!board_contains(b, a_x, a_y))
+                {
+                    continue;
+                }
+                int a = a_y * b->width + a_x;
+                if (var_of[a] >= 0)
+                {
+                    con_vars[con_n][size++] = var_of[a];
+                }
+                else if ((b->cells[a] & (CELL_OPENED | CELL_MINE)) == (CELL_OPENED | CELL_MINE))
+                {
+                    value--;
+                }
+            }
+        }
+        if (value < 0 || value > size)
+        {
+            ok = false;
+            break;
+        }
+        if (size == 0)
+        {
+            continue;
+        }
+        for (int j = 0; j < size; j++)
+        {
+            int v = con_vars[con_n][j];
+            var_cons[v][var_con_n[v]++] = con_n;
+            int root = find_root(parent, v);
+            int first = find_root(parent, con_vars[con_n][0]);
+            if (root != first)
+            {
+                parent[root] = first;
+            }
+        }
+        con_size[con_n] = size;
+        con_value[con_n] = value;
+        con_n++;
+    }
+
+    // Number the components
+    *component_n = 0;
+    for (int v = 0; v < var_n && ok; v++)
+    {
+        component_of[v] = -1;
+    }
+    for (int v = 0; v < var_n && ok; v++)
+    {
+        int root = find_root(parent, v);
+        if (component_of[root] < 0)
+        {
+            component_of[root] = (*component_n)++;
+        }
+        component_of[v] = component_of[root];
+    }
+    if (ok)
+    {
+        *components = calloc((size_t) (*component_n > 0 ? *component_n : 1), sizeof(struct component));
+        ok = *components != NULL;
+    }
+
+    // Collect each component breadth first, starting from the variable found last by a first search.
+    // Starting at one end of the frontier keeps the numbers that are partly assigned at once few
+    for (int v = 0; v < var_n && ok; v++)
+    {
+        local[v] = -1;
+    }
+    for (int con = 0; con < con_n && ok; con++)
+    {
+        con_local[con] = -1;
+    }
+    for (int v = 0; v < var_n && ok; v++)
+    {
+        if (local[v] >= 0)
+        {
+            continue;
+        }
+        struct component *c = &(*components)[component_of[v]];
+        int length = 0;
+        for (int search = 0; search < 2; search++)
+        {
+            int start = search == 0 ? v : queue[length - 1];
+            for (int j = 0; j < length; j++)
+            {
+                local[queue[j]] = -1;
+            }
+            length = 0;
+            queue[length++] = start;
+            local[start] = 0;
+            for (int head = 0; head < length; head++)
+            {
+                int u = queue[head];
+                for (int j = 0; j < var_con_n[u]; j++)
+                {
+                    int con = var_cons[u][j];
+                    for (int k = 0; k < con_size[con]; k++)
+                    {
+                        int w = con_vars[con][k];
+                        if (local[w] < 0)
+                        {
+                            local[w] = length;
+                            queue[length++] = w;
+                        }
+                    }
+                }
+            }
+        }
+        for (int j = 0; j < length; j++)
+        {
+            for (int k = 0; k < var_con_n[queue[j]]; k++)
+            {
+                int con = var_cons[queue[j]][k];
+                if (con_local[con] < 0)
+                {
+                    con_local[con] = c->con_n++;
+                }
+            }
+        }
+
+        c->var_n = length;
+        c->complete = length <= MAX_COMPONENT_VARS;
+        c->cells = malloc((size_t) length * sizeof(int));
+        c->var_cons = malloc((size_t) length * sizeof(*c->var_cons));
+        c->var_con_n = malloc((size_t) length * sizeof(int));
+        c->con_value = malloc((size_t) c->con_n * sizeof(int));
+        c->con_size = malloc((size_t) c->con_n * sizeof(int));
+        ok = c->cells != NULL && c->var_cons != NULL && c->var_con_n != NULL && c->con_value != NULL && c->con_size != NULL;
+        for (int j = 0; j < length && ok; j++)
+        {
+            int u = queue[j];
+            c->cells[j] = var_cell[u];
+            c->var_con_n[j] = var_con_n[u];
+            for (int k = 0; k < var_con_n[u]; k++)
+            {
+                int con = var_cons[u][k];
+                c->var_cons[j][k] = con_local[con];
+                c->con_value[con_local[con]] = con_value[con];
+                c->con_size[con_local[con]] = con_size[con];
+            }
+        }
+    }
+
+    free(con_vars);
+    free(con_size);
+    free(con_value);
+    free(con_local);
+    free(parent);
+    free(component_of);
+    free(local);
+    free(queue);
+    free(var_cons);
+    free(var_con_n);
+    return ok;
+}
+
+// Count every arrangement of mines in a component that agrees with its numbers
+static bool count_arrangements(struct component *c)
+{
+    if (!c->complete)
+    {
+        return false;
+    }
+    c->counts = calloc((size_t) c->var_n + 1, sizeof(double));
+    c->var_counts = calloc((size_t) c->var_n * (c->var_n + 1), sizeof(double));
+    if (c->counts == NULL || c->var_counts == NULL)
+    {
+        c->complete = false;
+        return false;
+    }
+    if (count_by_layers(c))
+    {
+        return c->complete;
+    }
+
+    // Too many numbers are partly assigned at once to merge arrangements, so go through them one by one
+    memset(c->var_counts, 0, (size_t) c->var_n * (c->var_n + 1) * sizeof(double));
+    struct search s;
+    s.c = c;
+    s.assigned = calloc((size_t) c->var_n, sizeof(char));
+    s.con_mines = calloc((size_t) c->con_n, sizeof(int));
+    s.con_unassigned = malloc((size_t) c->con_n * sizeof(int));
+    c->complete = s.assigned != NULL && s.con_mines != NULL && s.con_unassigned != NULL;
+    if (c->complete)
+    {
+        memcpy(s.con_unassigned, c->con_size, (size_t) c->con_n * sizeof(int));
+        c->nodes = 0;
+        enumerate(&s, 0, 0);
+    }
+    free(s.assigned);
+    free(s.con_mines);
+    free(s.con_unassigned);
+    return c->complete;
+}
+
+// Assign the variables one at a time. What can follow only depends on the mines around the numbers that are partly
+// assigned, so arrangements that agree on those are merged into one state. Counting forwards and backwards through
+// the layers of states gives the arrangements with each variable as a mine.
+// Returns false if the component is too wide to count this way
+static bool count_by_layers(struct component *c)
+{
+    int n = c->var_n;
+    int len = n + 1;
+    int *first = malloc((size_t) c->con_n * sizeof(int));
+    int *last = malloc((size_t) c->con_n * sizeof(int));
+    int *slot = malloc((size_t) c->con_n * sizeof(int));
+    int *seen = calloc((size_t) c->con_n, sizeof(int));
+    int (*remaining)[ADJACENT_N] = malloc((size_t) n * sizeof(*remaining));
+    int *table = malloc(STATE_TABLE_SIZE * sizeof(int));
+    struct layer *layers = calloc((size_t) n + 1, sizeof(struct layer));
+    bool handled = first != NULL && last != NULL && slot != NULL && seen != NULL && remaining != NULL && table != NULL &&
+                   layers != NULL;
+    bool fits = handled;
+    if (!handled)
+    {
+        c->complete = false;
+        handled = true;
+    }
+
+    // Find where each number's variables start and end, and give it a slot while it is partly assigned
+    for (int con = 0; con < c->con_n && fits; con++)
+    {
+        first[con] = -1;
+    }
+    for (int j = 0; j < n && fits; j++)
+    {
+        for (int k = 0; k < c->var_con_n[j]; k++)
+        {
+            int con = c->var_cons[j][k];
+            first[con] = first[con] < 0 ? j : first[con];
+            last[con] = j;
+            seen[con]++;
+            remaining[j][k] = c->con_size[con] - seen[con];
+        }
+    }
+    uint64_t free_slots = (1ULL << MAX_SLOTS) - 1;
+    for (int j = 0; j < n && fits; j++)
+    {
+        for (int k = 0; k < c->var_con_n[j] && fits; k++)
+        {
+            int con = c->var_cons[j][k];
+            if (first[con] == j)
+            {
+                fits = free_slots != 0;
+                slot[con] = fits ? __builtin_ctzll(free_slots) : 0;
+                free_slots &= ~(1ULL << slot[con]);
+            }
+        }
+        for (int k = 0; k < c->var_con_n[j] && fits; k++)
+        {
+            int con = c->var_cons[j][k];
+            if (last[con] == j)
+            {
+                free_slots |= 1ULL << slot[con];
+            }
+        }
+    }
+
+    // Forwards: the ways of reaching each state by number of mines. Every layer is kept for the way back, so a
+    // component whose layers need too much memory is left to backtracking
+    size_t bytes = 0;
+    if (fits)
+    {
+        fits = add_state(&layers[0], 0, NULL, len) == 0;
+        if (fits)
+        {
+            layers[0].before[0] = 1;
+        }
+    }
+    for (int d = 0; d < n && fits; d++)
+    {
+        struct layer *current = &layers[d];
+        struct layer *next = &layers[d + 1];
+        current->next = malloc((size_t) (current->state_n > 0 ? current->state_n : 1) * sizeof(*current->next));
+        fits = current->next != NULL;
+        for (int i = 0; i < STATE_TABLE_SIZE && fits; i++)
+        {
+            table[i] = -1;
+        }
+        for (int i = 0; i < current->state_n && fits; i++)
+        {
+            for (int mine = 0; mine <= 1 && fits; mine++)
+            {
+                state_t state = current->states[i];
+                bool possible = true;
+                for (int k = 0; k < c->var_con_n[d] && possible; k++)
+                {
+                    int con = c->var_cons[d][k];
+                    int shift = slot[con] * 4;
+                    int mines = (int) (state >> shift & 15) + mine;
+                    possible = mines <= c->con_value[con] && mines + remaining[d][k] >= c->con_value[con];
+
+                    // A fully assigned number frees its slot
+                    mines = last[con] == d ? 0 : mines;
+                    state = (state & ~((state_t) 15 << shift)) | (state_t) mines << shift;
+                }
+                current->next[i][mine] = -1;
+                if (!possible)
+                {
+                    continue;
+                }
+                int j = add_state(next, state, table, len);
+                fits = j >= 0;
+                if (fits)
+                {
+                    current->next[i][mine] = j;
+                    for (int a = 0; a <= d; a++)
+                    {
+                        next->before[j * len + a + mine] += current->before[i * len + a];
+                    }
+                }
+            }
+        }
+        bytes += (size_t) current->state_n * sizeof(*current->next) +
+                 (size_t) next->state_cap * (sizeof(state_t) + (size_t) len * sizeof(double));
+        fits = fits && bytes <= MAX_LAYER_BYTES;
+    }
+
+    // Backwards: the ways of completing each state by number of mines, combined with the ways of reaching it around
+    // every variable that is a mine. Each layer is freed once the one before it is done, so the way back needs no
+    // more memory than the way there
+    for (int d = n; d >= 0 && fits; d--)
+    {
+        struct layer *current = &layers[d];
+        current->after = calloc((size_t) (current->state_n > 0 ? current->state_n : 1) * len, sizeof(double));
+        fits = current->after != NULL;
+        if (!fits || d == n)
+        {
+            if (fits && current->state_n > 0)
+            {
+                current->after[0] = 1;
+            }
+            continue;
+        }
+        struct layer *next = &layers[d + 1];
+        for (int i = 0; i < current->state_n; i++)
+        {
+            for (int mine = 0; mine <= 1; mine++)
+            {
+                int j = current->next[i][mine];
+                for (int b = 0; j >= 0 && b < n - d; b++)
+                {
+                    current->after[i * len + b + mine] += next->after[j * len + b];
+                }
+            }
+            int j = current->next[i][1];
+            for (int a = 0; j >= 0 && a <= d; a++)
+            {
+                double ways = current->before[i * len + a];
+                for (int b = 0; ways > 0 && b < n - d; b++)
+                {
+                    c->var_counts[d * len + a + 1 + b] += ways * next->after[j * len + b];
+                }
+            }
+        }
+        free(next->after);
+        free(next->before);
+        free(next->states);
+        free(next->next);
+        next->after = NULL;
+        next->before = NULL;
+        next->states = NULL;
+        next->next = NULL;
+    }
+    if (fits)
+    {
+        for (int k = 0; k < len && layers[0].state_n > 0; k++)
+        {
+            c->counts[k] = layers[0].after[k];
+        }
+    }
+
+    for (int d = 0; d <= n && layers != NULL; d++)
+    {
+        free(layers[d].states);
+        free(layers[d].next);
+        free(layers[d].before);
+        free(layers[d].after);
+    }
+    free(layers);
+    free(first);
+    free(last);
+    free(slot);
+    free(seen);
+    free(remaining);
+    free(table);
+    return handled && (fits || !c->complete);
+}
+
+// Find a state in the layer or add it, returns -1 if the layer is full
+static int add_state(struct layer *l, state_t state, int *table, int len)
+{
+    int bucket = 0;
+    if (table != NULL)
+    {
+        uint64_t folded = (uint64_t) state ^ (uint64_t) (state >> 64);
+        bucket = (int) ((folded * 0x9E3779B97F4A7C15ULL) >> 40) & (STATE_TABLE_SIZE - 1);
+        while (table[bucket] >= 0)
+        {
+            if (l->states[table[bucket]] == state)
+            {
+                return table[bucket];
+            }
+            bucket = (bucket + 1) & (STATE_TABLE_SIZE - 1);
+        }
+    }
+    if (l->state_n == MAX_LAYER_STATES)
+    {
+        return -1;
+    }
+    if (l->state_n == l->state_cap)
+    {
+        int cap = l->state_cap == 0 ? 16 : l->state_cap * 2;
+        state_t *states = realloc(l->states, (size_t) cap * sizeof(state_t));
+        if (states != NULL)
+        {
+            l->states = states;
+        }
+        double *before = realloc(l->before, (size_t) cap * len * sizeof(double));
+        if (before != NULL)
+        {
+            l->before = before;
+        }
+        if (states == NULL || before == NULL)
+        {
+            return -1;
+        }
+        memset(&l->before[(size_t) l->state_cap * len], 0, (size_t) (cap - l->state_cap) * len * sizeof(double));
+        l->state_cap = cap;
+    }
+    if (table != NULL)
+    {
+        table[bucket] = l->state_n;
+    }
+    l->states[l->state_n] = state;
+    return l->state_n++;
+}
+
+// Backtrack through the variables in order, pruning as soon as a number can't be satisfied
+static void enumerate(struct search *s, int depth, int mines)
+{
+    struct component *c = s->c;
+    if (!c->complete)
+    {
+        return;
+    }
+    if (++c->nodes > NODE_LIMIT)
+    {
+        c->complete = false;
+        return;
+    }
+    if (depth == c->var_n)
+    {
+        c->counts[mines] += 1;
+        for (int v = 0; v < c->var_n; v++)
+        {
+            if (s->assigned[v])
+            {
+                c->var_counts[v * (c->var_n + 1) + mines] += 1;
+            }
+        }
+        return;
+    }
+
+    for (int value = 0; value <= 1; value++)
+    {
+        bool possible = true;
+        for (int j = 0; j < c->var_con_n[depth]; j++)
+        {
+            int con = c->var_cons[depth][j];
+            s->con_unassigned[con]--;
+            s->con_mines[con] += value;
+            if (s->con_mines[con] > c->con_value[con] || s->con_mines[con] + s->con_unassigned[con] < c->con_value[con])
+            {
+                possible = false;
+            }
+        }
+        if (possible)
+        {
+            s->assigned[depth] = value;
+            enumerate(s, depth + 1, mines + value);
+            s->assigned[depth] = 0;
+        }
+        for (int j = 0; j < c->var_con_n[depth]; j++)
+        {
+            int con = c->var_cons[depth][j];
+            s->con_unassigned[con]++;
+            s->con_mines[con] -= value;
+        }
+    }
+}
+
+// Weight every combination of the components by the ways the remaining mines fit in the cells away from the frontier
+static bool combine(const struct board *b, struct solution *s, struct component *components, int component_n,
+                    int unknown, int known_mines, int var_n)
+{
+    int mines_left = b->mines - known_mines;
+    int others = unknown - var_n;
+    if (mines_left < 0)
+    {
+        return false;
+    }
+
+    // Scale each component so the counts stay in range, constant factors cancel out in the probabilities
+    for (int c = 0; c < component_n; c++)
+    {
+        struct component *comp = &components[c];
+        double largest = 0;
+        for (int k = 0; k <= comp->var_n; k++)
+        {
+            largest = comp->counts[k] > largest ? comp->counts[k] : largest;
+        }
+        if (largest == 0)
+        {
+            return false;
+        }
+        for (int k = 0; k <= comp->var_n; k++)
+        {
+            comp->counts[k] /= largest;
+        }
+        for (int j = 0; j < comp->var_n * (comp->var_n + 1); j++)
+        {
+            comp->var_counts[j] /= largest;
+        }
+    }
+
+    // Arrangements of the frontier by number of mines, from the front and from the back of the components
+    int max_len = mines_left + 1;
+    double **prefix = calloc((size_t) component_n + 1, sizeof(double *));
+    double **suffix = calloc((size_t) component_n + 1, sizeof(double *));
+    int *prefix_len = calloc((size_t) component_n + 1, sizeof(int));
+    int *suffix_len = calloc((size_t) component_n + 1, sizeof(int));
+    double *weight = calloc((size_t) max_len, sizeof(double));
+    double one = 1;
+    bool ok = prefix != NULL && suffix != NULL && prefix_len != NULL && suffix_len != NULL && weight != NULL;
+    if (ok)
+    {
+        prefix[0] = convolve(&one, 1, &one, 1, max_len, &prefix_len[0]);
+        suffix[component_n] = convolve(&one, 1, &one, 1, max_len, &suffix_len[component_n]);
+        ok = prefix[0] != NULL && suffix[component_n] != NULL;
+    }
+    for (int c = 0; c < component_n && ok; c++)
+    {
+        prefix[c + 1] = convolve(prefix[c], prefix_len[c], components[c].counts, components[c].var_n + 1, max_len,
+                                 &prefix_len[c + 1]);
+        int r = component_n - 1 - c;
+        suffix[r] = convolve(suffix[r + 1], suffix_len[r + 1], components[r].counts, components[r].var_n + 1, max_len,
+                             &suffix_len[r]);
+        ok = prefix[c + 1] != NULL && suffix[r] != NULL;
+    }
+
+    // The cells away from the frontier can hold the remaining mines in C(others, mines_left - k) ways,
+    // found relative to the smallest possible k using C(n, r - 1) = C(n, r) * r / (n - r + 1)
+    int k_min = mines_left - others > 0 ? mines_left - others : 0;
+    double largest_log = -INFINITY;
+    double log_weight = 0;
+    for (int k = k_min; k < max_len && ok; k++)
+    {
+        weight[k] = log_weight;
+        largest_log = log_weight > largest_log ? log_weight : largest_log;
+        int r = mines_left - k;
+        if (r > 0)
+        {
+            log_weight += log(r) - log(others - r + 1);
+        }
+    }
+    for (int k = 0; k < max_len && ok; k++)
+    {
+        weight[k] = k >= k_min ? exp(weight[k] - largest_log) : 0;
+    }
+
+    double total = 0;
+    double other_mines = 0;
+    bool other_can_be_mine = false;
+    bool other_can_be_safe = false;
+    for (int k = 0; k < prefix_len[component_n] && ok; k++)
+    {
+        double w = prefix[component_n][k] * weight[k];
+        total += w;
+        if (w > 0 && others > 0)
+        {
+            other_mines += w * (mines_left - k) / others;
+            other_can_be_mine = other_can_be_mine || mines_left - k > 0;
+            other_can_be_safe = other_can_be_safe || mines_left - k < others;
+        }
+    }
+    ok = ok && total > 0;
+
+    // Chance of each frontier cell being a mine, counting the arrangements of every other component with it
+    double *expected = malloc((size_t) max_len * sizeof(double));
+    ok = ok && expected != NULL;
+    for (int c = 0; c < component_n && ok; c++)
+    {
+        struct component *comp = &components[c];
+        int rest_len;
+        double *rest = convolve(prefix[c], prefix_len[c], suffix[c + 1], suffix_len[c + 1], max_len, &rest_len);
+        if (rest == NULL)
+        {
+            ok = false;
+            break;
+        }
+        for (int k = 0; k <= comp->var_n && k < max_len; k++)
+        {
+            expected[k] = 0;
+            for (int j = 0; j < rest_len && k + j < max_len; j++)
+            {
+                expected[k] += rest[j] * weight[k + j];
+            }
+        }
+        free(rest);
+
+        for (int v = 0; v < comp->var_n; v++)
+        {
+            double mine = 0;
+            bool can_be_mine = false;
+            bool can_be_safe = false;
+            double *var_counts = &comp->var_counts[v * (comp->var_n + 1)];
+            for (int k = 0; k <= comp->var_n && k < max_len; k++)
+            {
+                if (expected[k] > 0 && comp->counts[k] > 0)
+                {
+                    mine += var_counts[k] * expected[k];
+                    can_be_mine = can_be_mine || var_counts[k] > 0;
+                    can_be_safe = can_be_safe || var_counts[k] < comp->counts[k];
+                }
+            }
+            s->probability[comp->cells[v]] = !can_be_mine ? 0 : (!can_be_safe ? 1 : mine / total);
+        }
+    }
+
+    // Cells away from the frontier all share the same chance
+    if (ok)
+    {
+        double other = !other_can_be_mine ? 0 : (!other_can_be_safe ? 1 : other_mines / total);
+        for (int i = 0; i < b->size; i++)
+        {
+            if (!(b->cells[i] & CELL_OPENED) && s->probability[i] < 0)
+            {
+                s->probability[i] = other;
+            }
+            if (!(b->cells[i] & CELL_OPENED))
+            {
+                s->safe += s->probability[i] == 0 ? 1 : 0;
+                s->mines += s->probability[i] == 1 ? 1 : 0;
+            }
+        }
+    }
+
+    for (int c = 0; c <= component_n && prefix != NULL && suffix != NULL; c++)
+    {
+        free(prefix[c]);
+        free(suffix[c]);
+    }
+    free(prefix);
+    free(suffix);
+    free(prefix_len);
+    free(suffix_len);
+    free(weight);
+    free(expected);
+    return ok;
+}
+
+// Without every component counted the mines can't be shared out between them exactly. A counted component still
+// shows which of its cells are a mine in all or none of its arrangements, and an uncounted one the cells of numbers
+// that are already full or need every cell around them. Every other cell gets the share of the mines that are left
+static void estimate(const struct board *b, struct solution *s, const struct component *components, int component_n,
+                     int unknown, int known_mines)
+{
+    double density = unknown > 0 ? (double) (b->mines - known_mines) / unknown : 0;
+    density = density < 0 ? 0 : (density > 1 ? 1 : density);
+    for (int i = 0; i < b->size; i++)
+    {
+        s->probability[i] = (b->cells[i] & CELL_OPENED) ? -1 : density;
+    }
+    for (int c = 0; c < component_n; c++)
+    {
+        const struct component *comp = &components[c];
+        for (int v = 0; v < comp->var_n; v++)
+        {
+            double *probability = &s->probability[comp->cells[v]];
+            if (comp->complete)
+            {
+                double total = 0;
+                double mine = 0;
+                for (int k = 0; k <= comp->var_n; k++)
+                {
+                    total += comp->counts[k];
+                    mine += comp->var_counts[v * (comp->var_n + 1) + k];
+                }
+                *probability = total > 0 ? mine / total : density;
+                continue;
+            }
+            for (int k = 0; k < comp->var_con_n[v]; k++)
+            {
+                int con = comp->var_cons[v][k];
+                if (comp->con_value[con] == 0)
+                {
+                    *probability = 0;
+                }
+                else if (comp->con_value[con] == comp->con_size[con])
+                {
+                    *probability = 1;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < b->size; i++)
+    {
+        if (!(b->cells[i] & CELL_OPENED))
+        {
+            s->safe += s->probability[i] == 0 ? 1 : 0;
+            s->mines += s->probability[i] == 1 ? 1 : 0;
+        }
+    }
+}
+
+// Multiply two polynomials, dropping terms past max_len
+static double *convolve(const double *a, int a_len, const double *b, int b_len, int max_len, int *len)
+{
+    *len = a_len + b_len - 1 < max_len ? a_len + b_len - 1 : max_len;
+    double *result = calloc((size_t) *len, sizeof(double));
+    if (result == NULL)
+    {
+        return NULL;
+    }
+    for (int i = 0; i < a_len && i < *len; i++)
+    {
+        for (int j = 0; j < b_len && i + j < *len; j++)
+        {
+            result[i + j] += a[i] * b[j];
+        }
+    }
+    return result;
+}
+
+static int find_root(int *parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// Count the arrangements of every component. When the pool has threads and the board has more than one large
+// component, the large ones are shared with the pool while the small ones are counted here
+static void count_components(struct component *components, int component_n)
+{
+    struct component **large = pool_thread_n > 0 ? malloc((size_t) component_n * sizeof(struct component *)) : NULL;
+    int large_n = 0;
+    for (int c = 0; c < component_n && large != NULL; c++)
+    {
+        if (components[c].var_n >= POOL_MIN_VARS)
+        {
+            large[large_n++] = &components[c];
+        }
+    }
+    if (large_n < 2)
+    {
+        free(large);
+        for (int c = 0; c < component_n; c++)
+        {
+            count_arrangements(&components[c]);
+        }
+        return;
+    }
+
+    struct task t = { large, large_n, 0, 0, NULL };
+    pthread_mutex_lock(&pool_lock);
+    t.next = pool_tasks;
+    pool_tasks = &t;
+    pthread_cond_broadcast(&pool_work);
+    pthread_mutex_unlock(&pool_lock);
+    for (int c = 0; c < component_n; c++)
+    {
+        if (components[c].var_n < POOL_MIN_VARS)
+        {
+            count_arrangements(&components[c]);
+        }
+    }
+    pthread_mutex_lock(&pool_lock);
+    work_on(&t);
+    while (t.counted < t.component_n)
+    {
+        pthread_cond_wait(&pool_done, &pool_lock);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    free(large);
+}
+
+static void *pool_worker(void *arg)
+{
+    (void) arg;
+    pthread_mutex_lock(&pool_lock);
+    while (true)
+    {
+        while (!pool_stopping && pool_tasks == NULL)
+        {
+            pthread_cond_wait(&pool_work, &pool_lock);
+        }
+        if (pool_stopping)
+        {
+            break;
+        }
+        work_on(pool_tasks);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return NULL;
+}
+
+// Count the components of a task until none are left to take, called with the pool's lock held. A task leaves the
+// list once its last component is taken
+static void work_on(struct task *t)
+{
+    while (t->taken < t->component_n)
+    {
+        struct component *c = t->components[t->taken++];
+        if (t->taken == t->component_n)
+        {
+            struct task **link = &pool_tasks;
+            while (*link != t)
+            {
+                link = &(*link)->next;
+            }
+            *link = t->next;
+        }
+        pthread_mutex_unlock(&pool_lock);
+        count_arrangements(c);
+        pthread_mutex_lock(&pool_lock);
+        if (++t->counted == t->component_n)
+        {
+            pthread_cond_broadcast(&pool_done);
+        }
+    }
+}
+
+static void free_components(struct component *components, int component_n)
+{
+    for (int c = 0; c < component_n && components != NULL; c++)
+    {
+        free(components[c].cells);
+        free(components[c].var_cons);
+        free(components[c].var_con_n);
+        free(components[c].con_value);
+        free(components[c].con_size);
+        free(components[c].counts);
+        free(components[c].var_counts);
+    }
+    free(components);
+}
@@ -0,0 +1,24 @@
+#ifndef MINESOLVER_H
+#define MINESOLVER_H
+
+#include <stdbool.h>
+#include "mineboard.h"
+
+struct solution
+{
+    double *probability; // Chance of each cell being a mine, -1 for opened cells
+    int safe;            // Unopened cells that can't be mines
+    int mines;           // Unopened cells that must be mines
+    int frontier;        // Unopened cells next to a number
+    int components;      // Independent groups of frontier cells
+    int uncounted;       // Groups with too many arrangements to count
+    bool complete;       // False if a group couldn't be counted, the chances are then only estimates
+};
+
+bool solution_init(struct solution *s, int size);
+void solution_free(struct solution *s);
+bool solve_board(const struct board *b, struct solution *s);
+int solver_start_threads(int threads);
+void solver_stop_threads();
+
+#endif
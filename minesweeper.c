@@ -1,18 +1,20 @@
 #include "minesweeper.h"
 
+#include <errno.h>
+#include <limits.h>
 #include <math.h>
-#include <ncurses.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+#include <strings.h>
+#include "minebatch.h"
+#include "mineboard.h"
+#include "mineworld.h"
+#include "render.h"
+#include "trace.h"
 #include "utils.h"
 
-#define GRID_LEN 9
-#define GRID_SIZE GRID_LEN * GRID_LEN
-#define GRID_OPENED 0
-#define GRID_UNOPENED 1
-#define MAX_MINES 10
 #define CH_GRID_UNOPENED '#'
 #define CH_GRID_EMPTY '.'
 #define CH_GRID_FLAGGED 'F'
@@ -24,142 +26,248 @@
 #define C_CYAN 5
 #define C_YELLOW 6
 #define MSG_SIZE 64
-#define ADJACENT_OFFSET_N 8
-const int ADJACENT_OFFSETS[ADJACENT_OFFSET_N] = { -GRID_LEN - 1, -GRID_LEN, -GRID_LEN + 1, -1, 1, GRID_LEN - 1, GRID_LEN, GRID_LEN + 1 };
+#define LETTER_COLUMNS 26 // Boards up to this width can be played by entering coordinates
+#define HUD_WIDTH 16
+#define FOOTER_HEIGHT 5
+#define INFINITE_DENSITY 20
+#define INFINITE_LIMIT (INT_MAX / 2) // Keeps coordinates around the cursor from overflowing
+
+struct difficulty
+{
+    const char *name;
+    int width;
+    int height;
+    int mines;
+};
+
+static const struct difficulty DIFFICULTIES[] = {
+    { "beginner", 9, 9, 10 },
+    { "intermediate", 16, 16, 40 },
+    { "expert", 30, 16, 99 },
+};
+#define DIFFICULTY_N (int) (sizeof(DIFFICULTIES) / sizeof(DIFFICULTIES[0]))
 
 static void update();
+static bool update_time();
 static void print_grid();
-int find_adjacent_mines(int grid_index);
-void reveal(int grid_index);
-bool is_mine(int grid_index);
+static bool parse_difficulty(int argc, char *argv[], int *width, int *height, int *mines);
+static bool parse_count(const char *text, long long *count);
+static uint8_t tile_at(int x, int y);
+static void move_cursor(int x, int y);
+static void select_tile(int x, int y);
 void reveal_tile(int x, int y);
-bool is_flag(int grid_index, int *flag_index);
-void add_flag(int grid_index);
-int i_to_x(int grid_index);
-int i_to_y(int grid_index);
+void flag_tile(int x, int y);
 void reset_input();
 
 static bool should_update;
 static bool game_end;
 static int input;
 int input_x;
-int input_y;
+int input_row; // Row number being entered (starting at 1), 0 if none
 bool should_flag;
 bool game_won;
 MEVENT event;
-int time_start;
-int time_elapsed;
+static double time_start; // Milliseconds on the game clock, see render_now()
+int time_elapsed;          // Whole seconds shown
 bool time_update;
 
-static int grid[GRID_SIZE]; // Store tile state (opened or unopened)
-int tiles[GRID_SIZE] = {0}; // Store adjacent mine numbers
-int mines[MAX_MINES] = {0}; // Store mine locations
-int flags[GRID_SIZE] = {0}; // Store flag locations
-int flags_amount;
+static bool infinite;
+static struct board board;
+static struct world world;
+int cursor_x;
+int cursor_y;
+int view_x; // Top left cell of the visible part of the board
+int view_y;
+int view_w;
+int view_h;
 static char message[MSG_SIZE];
 
-void minesweeper()
+int minesweeper(int argc, char *argv[])
 {
-    // Allow game to start
-    should_update = true;
-    game_end = false;
-    game_won = false;
-    should_flag = false;
-    reset_input();
-
-    // Start curses mode
-    initscr();
-
-    // Disable line buffering
-    cbreak();
-
-    // Don't echo user input
-    noecho();
-
-    // Set up colours
-    start_color();
-    use_default_colors();
-    init_pair(C_BLUE, COLOR_BLUE, -1);
-    init_pair(C_GREEN, COLOR_GREEN, -1);
-    init_pair(C_RED, COLOR_RED, -1);
-    init_pair(C_MAGENTA, COLOR_MAGENTA, -1);
-    init_pair(C_CYAN, COLOR_CYAN, -1);
-    init_pair(C_YELLOW, COLOR_YELLOW, -1);
-
-    // Set up mouse input
-    keypad(stdscr, TRUE);
-    mousemask(ALL_MOUSE_EVENTS | REPORT_MOUSE_POSITION, NULL);
-
-    // Set grid to unopened
-    for (int i = 0; i < GRID_SIZE; i++)
+    // Modes that run without a terminal
+    if (argc >= 1 && strcmp(argv[0], "--solve") == 0)
     {
-        grid[i] = GRID_UNOPENED;
+        return solve_files(argc - 1, argv + 1);
     }
 
-    // Rig mines
-    int placed_mines = 0;
-    bool good_pos;
-    do
+    // Options come before the difficulty
+    long long simulate = 0;
+    long long threads = 0;
+    bool valid = true;
+    int arg = 0;
+    while (arg + 1 < argc && strncmp(argv[arg], "--", 2) == 0)
     {
-        good_pos = true;
-        int pos = rand_range(0, GRID_SIZE - 1);
-        for (int i = 0; i < placed_mines; i++)
+        if (strcmp(argv[arg], "--simulate") == 0)
         {
-            if (mines[i] == pos)
-            {
-                good_pos = false;
-                break;
-            }
+            valid = valid && parse_count(argv[arg + 1], &simulate);
         }
-        if (good_pos)
+        else if (strcmp(argv[arg], "--threads") == 0)
         {
-            mines[placed_mines] = pos;
-            placed_mines++;
+            valid = valid && parse_count(argv[arg + 1], &threads);
         }
-    } while (placed_mines < MAX_MINES);
+        else
+        {
+            break;
+        }
+        arg += 2;
+    }
 
-    // Assign a number af adjacent mines to each tile
-    for (int i = 0; i < GRID_SIZE; i++)
+    int width, height, mines;
+    if (!valid || !parse_difficulty(argc - arg, argv + arg, &width, &height, &mines) || (infinite && simulate > 0))
     {
-        tiles[i] = find_adjacent_mines(i);
+        printf("Usage: ./play minesweeper [beginner | intermediate | expert | custom width height mines | infinite [mine_percent]]\n"
+               "       ./play minesweeper --simulate games [--threads n] [difficulty]\n"
+               "       ./play minesweeper --solve [--threads n] [--repeat n] file...\n");
+        return 1;
+    }
+    if (simulate > 0)
+    {
+        return simulate_games(simulate, threads > INT_MAX ? INT_MAX : (int) threads, width, height, mines);
+    }
+    if (infinite)
+    {
+        if (!world_init(&world, rand_get_seed(), mines))
+        {
+            printf("Invalid mine density: %i%%\n", mines);
+            return 1;
+        }
+    }
+    else if (!board_init(&board, width, height, mines))
+    {
+        printf("Invalid board: %ix%i with %i mines\n", width, height, mines);
+        return 1;
     }
 
-    flags_amount = 0;
-
-    // Start timer
-    time_start = time(NULL);
-    nodelay(stdscr, true);
+    // Allow game to start
+    should_update = true;
+    game_end = false;
+    game_won = false;
+    should_flag = false;
+    message[0] = '\0';
+    reset_input();
+    cursor_x = infinite ? 0 : width / 2;
+    cursor_y = infinite ? 0 : height / 2;
+    view_x = 0;
+    view_y = 0;
+
+    // Start drawing with the mouse and the colours of the numbers
+    render_start(true);
+    render_colour(C_BLUE, COLOR_BLUE, -1);
+    render_colour(C_GREEN, COLOR_GREEN, -1);
+    render_colour(C_RED, COLOR_RED, -1);
+    render_colour(C_MAGENTA, COLOR_MAGENTA, -1);
+    render_colour(C_CYAN, COLOR_CYAN, -1);
+    render_colour(C_YELLOW, COLOR_YELLOW, -1);
+
+    // Start timer, it ticks every whole second after the start of the game
+    time_start = render_now();
+    time_elapsed = 0;
     time_update = true;
 
+    // Sleep until a key is pressed or the shown time changes at the next whole second
+    bool redraw = true;
     while (should_update)
     {
-        erase();
-        print_grid();
-        update();
-        refresh();
+        if (redraw)
+        {
+            double start = trace_begin();
+            render_erase();
+            print_grid();
+            trace_end("render", start);
+            render_present();
+        }
+        if (!render_wait(1000 - fmod(render_now() - time_start, 1000)))
+        {
+            break;
+        }
+        redraw = update_time();
+
+        // Handle every waiting key, a resized terminal also arrives as a key
+        double start = trace_begin();
+        while (should_update && (input = render_key(0)) != ERR)
+        {
+            update();
+            redraw = true;
+        }
+        trace_end("update", start);
     }
 
-    endwin();
+    render_stop();
+    printf("Seed: %llu\n", (unsigned long long) rand_get_seed());
+    if (infinite)
+    {
+        world_free(&world);
+    }
+    else
+    {
+        board_free(&board);
+    }
+    return 0;
 }
 
-static void update()
+// Read the board size from the command line, defaults to beginner. For the infinite world mines is a percentage
+static bool parse_difficulty(int argc, char *argv[], int *width, int *height, int *mines)
 {
-    // Track time
-    if (time_update)
+    infinite = argc >= 1 && strcasecmp(argv[0], "infinite") == 0;
+    if (infinite && argc <= 2)
     {
-        time_elapsed = time(NULL) - time_start;
+        *width = 0;
+        *height = 0;
+        *mines = argc == 2 ? atoi(argv[1]) : INFINITE_DENSITY;
+        return true;
     }
-
-    // Stop timer and pause game after game ends
-    if (game_end)
+    if (argc == 0)
     {
-        time_update = false;
-        nodelay(stdscr, false);
+        *width = DIFFICULTIES[0].width;
+        *height = DIFFICULTIES[0].height;
+        *mines = DIFFICULTIES[0].mines;
+        return true;
+    }
+    if (argc == 4 && strcasecmp(argv[0], "custom") == 0)
+    {
+        *width = atoi(argv[1]);
+        *height = atoi(argv[2]);
+        *mines = atoi(argv[3]);
+        return true;
     }
+    for (int i = 0; i < DIFFICULTY_N && argc == 1; i++)
+    {
+        if (strcasecmp(argv[0], DIFFICULTIES[i].name) == 0)
+        {
+            *width = DIFFICULTIES[i].width;
+            *height = DIFFICULTIES[i].height;
+            *mines = DIFFICULTIES[i].mines;
+            return true;
+        }
+    }
+    return false;
+}
 
-    // Get user input
-    input = getch();
+// Read a number of games or threads, which has to be a whole number above 0
+static bool parse_count(const char *text, long long *count)
+{
+    char *end;
+    errno = 0;
+    *count = strtoll(text, &end, 10);
+    return end != text && *end == '\0' && errno == 0 && *count > 0;
+}
+
+// Returns true if the shown time changed
+static bool update_time()
+{
+    if (!time_update)
+    {
+        return false;
+    }
+    int seconds = (int) ((render_now() - time_start) / 1000);
+    bool changed = seconds != time_elapsed;
+    time_elapsed = seconds;
+    return changed;
+}
 
+// Handle one key or mouse event
+static void update()
+{
     if (game_end)
     {
         if (input != KEY_MOUSE)
@@ -173,59 +281,82 @@ static void update()
     // Mouse input
     if (input == KEY_MOUSE)
     {
-        if (getmouse(&event) == OK)
+        if (render_mouse(&event) && event.y < view_h && event.x < view_w * 2)
         {
+            int x = view_x + (event.x - 1) / 2;
+            int y = view_y + event.y;
+
             // Left mouse button: reveal tile
             if (event.bstate & BUTTON1_CLICKED)
             {
-                if (event.y < GRID_LEN && event.x < GRID_LEN * 2)
-                {
-                    reveal_tile((event.x - 1) / 2, event.y);
-                }
+                move_cursor(x, y);
+                reveal_tile(x, y);
             }
 
             // Middle mouse button: flag a tile
             // NOTE: right mouse button doesn't always work because the terminal uses it for pasting from the clipboard
             else if (event.bstate & BUTTON2_CLICKED)
             {
-                if (event.y < GRID_LEN && event.x < GRID_LEN * 2)
-                {
-                    int grid_index = event.y * GRID_LEN + (event.x - 1) / 2;
-                    if (grid[grid_index] == GRID_UNOPENED)
-                    {
-                        add_flag(grid_index);
-                    }
-                }
+                move_cursor(x, y);
+                flag_tile(x, y);
             }
         }
     }
 
     // Keyboard input
-    else if (input == '0')
+    else if (input == '0' && input_row == 0)
     {
         should_update = false;
     }
-    else if (input >= 'a' && input <= 'i')
+    else if (input >= 'a' && input <= 'z' && !infinite && board.width <= LETTER_COLUMNS)
     {
-        input_x = input - 'a';
+        if (input - 'a' < board.width)
+        {
+            input_x = input - 'a';
+            input_row = 0;
+        }
     }
-    else if (input >= '1' && input <= '9')
+    else if (input >= '0' && input <= '9' && !infinite && board.width <= LETTER_COLUMNS)
     {
-        input_y = input - '1';
-        if (input_x >= 0)
+        int row = input_row * 10 + input - '0';
+        if (row >= 1 && row <= board.height)
         {
-            if (should_flag)
-            {
-                add_flag(input_y * GRID_LEN + input_x);
-                should_flag = false;
-            }
-            else
+            input_row = row;
+
+            // Select the tile as soon as another digit can't make a valid row
+            if (input_x >= 0 && input_row * 10 > board.height)
             {
-                reveal_tile(input_x, input_y);
+                select_tile(input_x, input_row - 1);
             }
-            reset_input();
         }
     }
+    else if (input == ' ' || input == '\n' || input == KEY_ENTER)
+    {
+        if (input_x >= 0 && input_row > 0)
+        {
+            select_tile(input_x, input_row - 1);
+        }
+        else
+        {
+            select_tile(cursor_x, cursor_y);
+        }
+    }
+    else if (input == KEY_UP)
+    {
+        move_cursor(cursor_x, cursor_y - 1);
+    }
+    else if (input == KEY_DOWN)
+    {
+        move_cursor(cursor_x, cursor_y + 1);
+    }
+    else if (input == KEY_LEFT)
+    {
+        move_cursor(cursor_x - 1, cursor_y);
+    }
+    else if (input == KEY_RIGHT)
+    {
+        move_cursor(cursor_x + 1, cursor_y);
+    }
     else if (input == 'F')
     {
         should_flag = !should_flag;
@@ -235,300 +366,255 @@ static void update()
         reset_input();
     }
 
-    // Check for win
-    bool win = true;
-    for (int i = 0; i < GRID_SIZE; i++)
-    {
-        if (grid[i] == GRID_UNOPENED && !is_mine(i))
-        {
-            win = false;
-            break;
-        }
-    }
-    if (win)
+    // Check for win, the infinite world can only be lost
+    if (!game_end && !infinite && board_won(&board))
     {
         game_won = true;
         game_end = true;
-        snprintf(message, MSG_SIZE, "You won!");
+        snprintf(message, MSG_SIZE, "You won in %.2fs!", (render_now() - time_start) / 1000);
+    }
+
+    // Stop the timer after the game ends
+    if (game_end && time_update)
+    {
+        update_time();
+        time_update = false;
     }
 }
 
 static void print_grid()
 {
-    for (int y = 0; y < GRID_LEN; y++)
+    // Fit as much of the board on the screen as possible, scrolling so the cursor stays visible
+    view_h = get_height() - FOOTER_HEIGHT;
+    view_h = view_h < 1 ? 1 : (!infinite && view_h > board.height ? board.height : view_h);
+    if (cursor_y < view_y)
+    {
+        view_y = cursor_y;
+    }
+    else if (cursor_y >= view_y + view_h)
+    {
+        view_y = cursor_y - view_h + 1;
+    }
+    if (!infinite && view_y > board.height - view_h)
+    {
+        view_y = board.height - view_h;
+    }
+
+    // Rows are numbered from 1, the infinite world shows its real coordinates
+    int label_offset = infinite ? 0 : 1;
+    char label[16];
+    int label_len = snprintf(label, sizeof(label), "%i", view_y + label_offset);
+    int label_len_end = snprintf(label, sizeof(label), "%i", view_y + view_h - 1 + label_offset);
+    label_len = label_len > label_len_end ? label_len : label_len_end;
+
+    view_w = (get_width() - label_len - HUD_WIDTH - 3) / 2;
+    view_w = view_w < 1 ? 1 : (!infinite && view_w > board.width ? board.width : view_w);
+    if (cursor_x < view_x)
+    {
+        view_x = cursor_x;
+    }
+    else if (cursor_x >= view_x + view_w)
     {
-        move(y, 0);
-        for (int x = 0; x < GRID_LEN; x++)
+        view_x = cursor_x - view_w + 1;
+    }
+    if (!infinite && view_x > board.width - view_w)
+    {
+        view_x = board.width - view_w;
+    }
+
+    // Only visit the cells that are on the screen
+    for (int y = 0; y < view_h; y++)
+    {
+        render_move(y, 0);
+        for (int x = 0; x < view_w; x++)
         {
             // Ensure everyting is evenly spaced out
-            addch(' ');
+            render_add(' ');
 
-            // Convert x and y coordinates to a grid index (y is already a multiple of 9)
-            int grid_index = y * GRID_LEN + x;
+            uint8_t cell = tile_at(view_x + x, view_y + y);
+            attr_t attrs = A_NORMAL;
+            chtype ch;
+            if (cell & CELL_FLAG)
+            {
+                attrs = A_BOLD | COLOR_PAIR(game_end && (cell & CELL_MINE) ? C_GREEN : C_RED);
+                ch = CH_GRID_FLAGGED;
+            }
 
-            // Print tiles
-            if (grid[grid_index] == GRID_OPENED)
+            // Reveal all mines if the game has ended
+            else if (game_end && (cell & CELL_MINE))
+            {
+                ch = CH_GRID_MINE;
+            }
+            else if (cell & CELL_OPENED)
             {
                 // If there are adjacent mines, print a number
-                if (tiles[grid_index] > 0)
+                int adjacent_mines = cell & CELL_COUNT_MASK;
+                if (adjacent_mines > 0)
                 {
-                    attron(COLOR_PAIR(tiles[grid_index] % 3 + 1));
-                    addch(tiles[grid_index] + '0');
-                    attroff(COLOR_PAIR(tiles[grid_index] % 3 + 1));
+                    attrs = COLOR_PAIR(adjacent_mines % 3 + 1);
+                    ch = adjacent_mines + '0';
                 }
                 else
                 {
-                    addch(CH_GRID_EMPTY);
+                    ch = CH_GRID_EMPTY;
                 }
             }
             else
             {
-                addch(CH_GRID_UNOPENED);
+                ch = CH_GRID_UNOPENED;
             }
-        }
-    }
 
-    // Print coordinates
-    for (int y = 0; y < GRID_LEN; y++)
-    {
-        if (y == input_y)
-        {
-            attron(COLOR_PAIR(C_CYAN));
-        }
-        mvaddch(y, GRID_LEN * 2 + 2, y + 1 + '0');
-        attroff(COLOR_PAIR(C_CYAN));
-    }
-    for (int x = 0; x < GRID_LEN; x++)
-    {
-        if (x == input_x)
-        {
-            attron(COLOR_PAIR(C_CYAN));
+            if (!game_end && view_x + x == cursor_x && view_y + y == cursor_y)
+            {
+                attrs |= A_REVERSE;
+            }
+            render_add(ch | attrs);
         }
-        mvaddch(GRID_LEN + 1, x * 2 + 1, x + 'a');
-        attroff(COLOR_PAIR(C_CYAN));
     }
 
-    // Reset cursor position
-    move(0, 0);
-
-    if (game_end)
+    // Print coordinates
+    for (int y = 0; y < view_h; y++)
     {
-        // Reveal all mines if the game has ended
-        move(0, 0);
-        for (int i = 0; i < MAX_MINES; i++)
+        if (view_y + y == input_row - 1)
         {
-            mvaddch(i_to_y(mines[i]), i_to_x(mines[i]) * 2 + 1, CH_GRID_MINE);
+            render_attr_on(COLOR_PAIR(C_CYAN));
         }
+        render_print_at(y, view_w * 2 + 2, "%i", view_y + y + label_offset);
+        render_attr_off(COLOR_PAIR(C_CYAN));
     }
-
-    // Print flags
-    for (int i = 0; i < flags_amount; i++)
+    for (int x = 0; x < view_w && !infinite && view_x + x < LETTER_COLUMNS && board.width <= LETTER_COLUMNS; x++)
     {
-        if (game_end && is_mine(flags[i]))
+        if (view_x + x == input_x)
         {
-            attron(COLOR_PAIR(C_GREEN));
+            render_attr_on(COLOR_PAIR(C_CYAN));
         }
-        else
-        {
-            attron(COLOR_PAIR(C_RED));
-        }
-        attron(A_BOLD);
-        mvaddch(i_to_y(flags[i]), i_to_x(flags[i]) * 2 + 1, CH_GRID_FLAGGED);
-        attroff(A_BOLD | COLOR_PAIR(C_RED) | COLOR_PAIR(C_GREEN));
+        render_add_at(view_h + 1, x * 2 + 1, view_x + x + 'a');
+        render_attr_off(COLOR_PAIR(C_CYAN));
     }
 
     // Calculate indicator position
-    int indicators_x = GRID_LEN * 2 + 4;
+    int indicators_x = view_w * 2 + label_len + 3;
 
     // Print timer
-    move(0, indicators_x);
-    printw("Time: %i", time_elapsed);
+    render_move(0, indicators_x);
+    render_print("Time: %i", time_elapsed);
 
     // Flag count
     move_x(indicators_x);
     move_rel_y(1);
-    printw("Flags: %i/%i", flags_amount, MAX_MINES);
+    if (infinite)
+    {
+        render_print("Flags: %i", world.flags);
+        move_x(indicators_x);
+        move_rel_y(1);
+        render_print("Opened: %lli", world.revealed);
+        move_x(indicators_x);
+        move_rel_y(1);
+        render_print("Chunks: %zu", world.chunk_n);
+    }
+    else
+    {
+        render_print("Flags: %i/%i", board.flags, board.mines);
+    }
 
     // Flag indicator
     if (should_flag)
     {
         move_x(indicators_x);
         move_rel_y(1);
-        attron(A_BOLD | COLOR_PAIR(C_RED));
-        printw("Flag");
-        attroff(A_BOLD | COLOR_PAIR(C_RED));
+        render_attr_on(A_BOLD | COLOR_PAIR(C_RED));
+        render_print("Flag");
+        render_attr_off(A_BOLD | COLOR_PAIR(C_RED));
     }
 
     // Print any messages
-    move(GRID_LEN + 3, 0);
-    printw("%s", message);
+    render_move(view_h + 3, 0);
+    render_print("%s", message);
     if (game_end)
     {
         new_line(1);
-        printw("Press any key to exit...");
+        render_print("Press any key to exit...");
     }
 }
 
-// Find all mines in the adjacent 8 tiles to the given grid index
-int find_adjacent_mines(int grid_index)
+static uint8_t tile_at(int x, int y)
 {
-    int x = i_to_x(grid_index);
-    int y = i_to_y(grid_index);
-
-    int adjacent_mines = 0;
-    for (int i = 0; i < ADJACENT_OFFSET_N; i++)
+    if (infinite)
     {
-        int adjacent_index = grid_index + ADJACENT_OFFSETS[i];
-        if (adjacent_index >= 0 && adjacent_index < GRID_SIZE)
-        {
-            // If a tile is on the edge, make sure tiles from the other side of the grid don't count
-            int a_x = i_to_x(adjacent_index);
-            int a_y = i_to_y(adjacent_index);
-            if(abs(a_x - x) > 1 || abs(a_y - y) > 1)
-            {
-                continue;
-            }
-
-            if (is_mine(adjacent_index))
-            {
-                adjacent_mines++;
-            }
-        }
+        return world_cell(&world, x, y);
     }
-    return adjacent_mines;
+    return *board_cell(&board, x, y);
 }
 
-// Reveal tiles and its adjacent ones if there are no adjacent mines (flood fill)
-void reveal(int grid_index)
+// Move the cursor, keeping it on the board
+static void move_cursor(int x, int y)
 {
-    if (grid_index < 0 || grid_index >= GRID_SIZE)
-    {
-        return;
-    }
-    if (grid[grid_index] == GRID_OPENED)
-    {
-        return;
-    }
-
-    grid[grid_index] = GRID_OPENED;
-
-    if (tiles[grid_index] > 0)
-    {
-        return;
-    }
-
-    int x = i_to_x(grid_index);
-    int y = i_to_y(grid_index);
-
-    for (int i = 0; i < ADJACENT_OFFSET_N; i++)
-    {
-        int adjacent_index = grid_index + ADJACENT_OFFSETS[i];
-        if (adjacent_index >= 0 && adjacent_index < GRID_SIZE)
-        {
-            // If a tile is on the edge, make sure tiles from the other side of the grid don't count
-            int a_x = i_to_x(adjacent_index);
-            int a_y = i_to_y(adjacent_index);
-            if(abs(a_x - x) > 1 || abs(a_y - y) > 1)
-            {
-                continue;
-            }
-
-            reveal(adjacent_index);
-        }
-    }
+    int max_x = infinite ? INFINITE_LIMIT : board.width - 1;
+    int max_y = infinite ? INFINITE_LIMIT : board.height - 1;
+    int min = infinite ? -INFINITE_LIMIT : 0;
+    cursor_x = x < min ? min : (x > max_x ? max_x : x);
+    cursor_y = y < min ? min : (y > max_y ? max_y : y);
 }
 
-// Check if there is a mine at the given index
-bool is_mine(int grid_index)
+// Reveal or flag a tile selected with the keyboard
+static void select_tile(int x, int y)
 {
-    for (int i = 0; i < MAX_MINES; i++)
+    move_cursor(x, y);
+    if (should_flag)
     {
-        if (mines[i] == grid_index)
-        {
-            return true;
-        }
+        flag_tile(x, y);
+        should_flag = false;
     }
-    return false;
+    else
+    {
+        reveal_tile(x, y);
+    }
+    reset_input();
 }
 
 // Reveal the specified tile or end game if there is a mine
 void reveal_tile(int x, int y)
 {
-    int grid_index = y * GRID_LEN + x;
-    if (grid[grid_index] == GRID_UNOPENED)
+    // Rig mines on the first click so it can't hit one, the infinite world generates them as it goes
+    if (!infinite && !board.rigged && board_contains(&board, x, y))
     {
-        if (is_flag(grid_index, NULL))
-        {
-            return;
-        }
-        if (is_mine(grid_index))
+        struct rng r;
+        rng_seed(&r, rand_get_seed());
+        if (!board_rig_mines(&board, &r, x, y) || !board_index_regions(&board))
         {
             game_end = true;
-            snprintf(message, MSG_SIZE, "You lost :(");
-        }
-        else
-        {
-            reveal(grid_index);
+            snprintf(message, MSG_SIZE, "Not enough memory for a %ix%i board", board.width, board.height);
+            return;
         }
     }
-}
 
-bool is_flag(int grid_index, int *flag_index)
-{
-    for (int i = 0; i < flags_amount; i++)
+    if (infinite && world_reveal(&world, x, y))
     {
-        if (flags[i] == grid_index)
-        {
-            if (flag_index != NULL)
-            {
-                *flag_index = i;
-            }
-            return true;
-        }
+        game_end = true;
+        snprintf(message, MSG_SIZE, "You lost :( %lli tiles opened", world.revealed);
+    }
+    else if (!infinite && board_reveal(&board, x, y))
+    {
+        game_end = true;
+        snprintf(message, MSG_SIZE, "You lost :( %i/%i mines flagged", board.correct_flags, board.mines);
     }
-    return false;
 }
 
-// Add or remove a flag at the specified grid index
-void add_flag(int grid_index)
+// Add or remove a flag on the specified tile
+void flag_tile(int x, int y)
 {
-    // Check if there is already a flag at that position
-    int flag_index;
-    bool is_flagged = is_flag(grid_index, &flag_index);
-
-    // If there is a flag remove it
-    if (is_flagged)
+    if (infinite)
     {
-        // Shift the rest of the array to the right
-        for (int j = flag_index; j < flags_amount - 1; j++)
-        {
-            flags[j] = flags[j + 1];
-        }
-        flags_amount--;
+        world_toggle_flag(&world, x, y);
     }
-
-    // Otherwise, add a flag
     else
     {
-        flags[flags_amount] = grid_index;
-        flags_amount++;
+        board_toggle_flag(&board, x, y);
     }
 }
 
-// Convert a grid index to its x coordinate (additional calcutations are necessary before printing to the screen, to account for white spaces between characters)
-int i_to_x(int grid_index)
-{
-    return grid_index % GRID_LEN;
-}
-
-// Convert a grid index to its y coordinate
-int i_to_y(int grid_index)
-{
-    return grid_index / GRID_LEN;
-}
-
 void reset_input()
 {
     input_x = -1;
-    input_y = -1;
+    input_row = 0;
 }
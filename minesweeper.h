@@ -1 +1 @@
-void minesweeper();
+int minesweeper(int argc, char *argv[]);
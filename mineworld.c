@@ -0,0 +1,247 @@
+#include "mineworld.h"
+
+#include <stdlib.h>
+#include "mineboard.h"
+#include "utils.h"
+
+#define BUCKETS_START 64
+#define MAX_CASCADE (1 << 20) // Cells opened by a single click, larger openings continue when clicked again
+#define CHUNK_MASK (CHUNK_LEN - 1)
+
+static bool is_mine(const struct world *w, int x, int y);
+static int find_adjacent_mines(const struct world *w, int x, int y);
+static struct chunk *find_chunk(struct world *w, int chunk_x, int chunk_y, bool create);
+static uint8_t *find_state(struct world *w, int x, int y, bool create);
+static bool push(struct world *w, int x, int y, size_t *length);
+
+bool world_init(struct world *w, uint64_t seed, int density_percent)
+{
+    if (density_percent < 1 || density_percent > 99)
+    {
+        return false;
+    }
+    w->buckets = calloc(BUCKETS_START, sizeof(struct chunk *));
+    if (w->buckets == NULL)
+    {
+        return false;
+    }
+    w->bucket_n = BUCKETS_START;
+    w->chunk_n = 0;
+    w->seed = seed;
+    w->mine_threshold = (uint32_t) (((uint64_t) density_percent << 32) / 100);
+    w->queue = NULL;
+    w->queue_cap = 0;
+    w->revealed = 0;
+    w->flags = 0;
+    w->exploded = false;
+    return true;
+}
+
+void world_free(struct world *w)
+{
+    for (size_t i = 0; i < w->bucket_n; i++)
+    {
+        struct chunk *c = w->buckets[i];
+        while (c != NULL)
+        {
+            struct chunk *next = c->next;
+            free(c);
+            c = next;
+        }
+    }
+    free(w->buckets);
+    free(w->queue);
+    w->buckets = NULL;
+    w->queue = NULL;
+}
+
+// Returns a cell in the same packed format as struct board
+uint8_t world_cell(struct world *w, int x, int y)
+{
+    uint8_t *state = find_state(w, x, y, false);
+    uint8_t cell = state != NULL ? *state : 0;
+    if (is_mine(w, x, y))
+    {
+        cell |= CELL_MINE;
+    }
+    return cell | find_adjacent_mines(w, x, y);
+}
+
+// Open a cell and flood fill the empty area around it, returns true if a mine was hit
+bool world_reveal(struct world *w, int x, int y)
+{
+    uint8_t *state = find_state(w, x, y, true);
+    if (state == NULL || (*state & CELL_FLAG))
+    {
+        return false;
+    }
+    if (is_mine(w, x, y))
+    {
+        *state |= CELL_OPENED;
+        w->exploded = true;
+        return true;
+    }
+    if (!(*state & CELL_OPENED))
+    {
+        *state |= CELL_OPENED;
+        w->revealed++;
+    }
+
+    // Clicking an opened empty cell carries on a flood fill that was cut short
+    size_t length = 0;
+    size_t opened = 0;
+    push(w, x, y, &length);
+    while (length > 0 && opened < MAX_CASCADE)
+    {
+        struct world_pos pos = w->queue[--length];
+        if (find_adjacent_mines(w, pos.x, pos.y) > 0)
+        {
+            continue;
+        }
+        for (int a_y = pos.y - 1; a_y <= pos.y + 1; a_y++)
+        {
+            for (int a_x = pos.x - 1; a_x <= pos.x + 1; a_x++)
+            {
+                uint8_t *adjacent = find_state(w, a_x, a_y, true);
+                if (adjacent == NULL || (*adjacent & (CELL_OPENED | CELL_FLAG)))
+                {
+                    continue;
+                }
+                *adjacent |= CELL_OPENED;
+                w->revealed++;
+                opened++;
+                if (!push(w, a_x, a_y, &length))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Add or remove a flag on an unopened cell
+void world_toggle_flag(struct world *w, int x, int y)
+{
+    uint8_t *state = find_state(w, x, y, true);
+    if (state == NULL || (*state & CELL_OPENED))
+    {
+        return;
+    }
+    *state ^= CELL_FLAG;
+    w->flags += (*state & CELL_FLAG) ? 1 : -1;
+}
+
+// The cells around the origin are always safe so the first click can't lose
+static bool is_mine(const struct world *w, int x, int y)
+{
+    if (abs(x) <= 1 && abs(y) <= 1)
+    {
+        return false;
+    }
+    uint64_t key = (uint64_t) (uint32_t) x << 32 | (uint32_t) y;
+    return (uint32_t) (rng_mix(w->seed ^ rng_mix(key, 0), 0) >> 32) < w->mine_threshold;
+}
+
+static int find_adjacent_mines(const struct world *w, int x, int y)
+{
+    int adjacent_mines = 0;
+    for (int a_y = y - 1; a_y <= y + 1; a_y++)
+    {
+        for (int a_x = x - 1; a_x <= x + 1; a_x++)
+        {
+            if ((a_x != x || a_y != y) && is_mine(w, a_x, a_y))
+            {
+                adjacent_mines++;
+            }
+        }
+    }
+    return adjacent_mines;
+}
+
+static struct chunk *find_chunk(struct world *w, int chunk_x, int chunk_y, bool create)
+{
+    uint64_t hash = rng_mix((uint64_t) (uint32_t) chunk_x << 32 | (uint32_t) chunk_y, 0);
+    struct chunk **bucket = &w->buckets[hash & (w->bucket_n - 1)];
+    for (struct chunk *c = *bucket; c != NULL; c = c->next)
+    {
+        if (c->chunk_x == chunk_x && c->chunk_y == chunk_y)
+        {
+            return c;
+        }
+    }
+    if (!create)
+    {
+        return NULL;
+    }
+
+    // Double the number of buckets once there is more than one chunk per bucket
+    if (w->chunk_n >= w->bucket_n)
+    {
+        size_t bucket_n = w->bucket_n * 2;
+        struct chunk **buckets = calloc(bucket_n, sizeof(struct chunk *));
+        if (buckets == NULL)
+        {
+            return NULL;
+        }
+        for (size_t i = 0; i < w->bucket_n; i++)
+        {
+            struct chunk *c = w->buckets[i];
+            while (c != NULL)
+            {
+                struct chunk *next = c->next;
+                uint64_t h = rng_mix((uint64_t) (uint32_t) c->chunk_x << 32 | (uint32_t) c->chunk_y, 0);
+                c->next = buckets[h & (bucket_n - 1)];
+                buckets[h & (bucket_n - 1)] = c;
+                c = next;
+            }
+        }
+        free(w->buckets);
+        w->buckets = buckets;
+        w->bucket_n = bucket_n;
+        bucket = &w->buckets[hash & (w->bucket_n - 1)];
+    }
+
+    struct chunk *c = calloc(1, sizeof(struct chunk));
+    if (c == NULL)
+    {
+        return NULL;
+    }
+    c->chunk_x = chunk_x;
+    c->chunk_y = chunk_y;
+    c->next = *bucket;
+    *bucket = c;
+    w->chunk_n++;
+    return c;
+}
+
+// Find the stored opened and flag bits of a cell, NULL if its chunk was never touched
+static uint8_t *find_state(struct world *w, int x, int y, bool create)
+{
+    // Shifting rounds towards negative infinity, so negative coordinates land in the right chunk
+    struct chunk *c = find_chunk(w, x >> CHUNK_BITS, y >> CHUNK_BITS, create);
+    if (c == NULL)
+    {
+        return NULL;
+    }
+    return &c->cells[(y & CHUNK_MASK) * CHUNK_LEN + (x & CHUNK_MASK)];
+}
+
+static bool push(struct world *w, int x, int y, size_t *length)
+{
+    if (*length == w->queue_cap)
+    {
+        size_t cap = w->queue_cap == 0 ? 256 : w->queue_cap * 2;
+        struct world_pos *queue = realloc(w->queue, cap * sizeof(struct world_pos));
+        if (queue == NULL)
+        {
+            return false;
+        }
+        w->queue = queue;
+        w->queue_cap = cap;
+    }
+    w->queue[*length].x = x;
+    w->queue[*length].y = y;
+    (*length)++;
+    return true;
+}
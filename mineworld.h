@@ -0,0 +1,50 @@
+#ifndef MINEWORLD_H
+#define MINEWORLD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Cells are stored in square chunks, only chunks that were opened or flagged exist in memory
+#define CHUNK_BITS 4
+#define CHUNK_LEN (1 << CHUNK_BITS)
+
+struct chunk
+{
+    int chunk_x;
+    int chunk_y;
+    uint8_t cells[CHUNK_LEN * CHUNK_LEN]; // Only the opened and flag bits, mines are generated
+    struct chunk *next;
+};
+
+struct world_pos
+{
+    int x;
+    int y;
+};
+
+// An unbounded board, whether a cell is a mine is a hash of the seed and its coordinates
+struct world
+{
+    uint64_t seed;
+    uint32_t mine_threshold;
+
+    struct chunk **buckets;
+    size_t bucket_n;
+    size_t chunk_n;
+
+    struct world_pos *queue; // Reused between flood fills
+    size_t queue_cap;
+
+    long long revealed;
+    int flags;
+    bool exploded;
+};
+
+bool world_init(struct world *w, uint64_t seed, int density_percent);
+void world_free(struct world *w);
+uint8_t world_cell(struct world *w, int x, int y);
+bool world_reveal(struct world *w, int x, int y);
+void world_toggle_flag(struct world *w, int x, int y);
+
+#endif
@@ -0,0 +1,397 @@
+#include "record.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "render.h"
+#include "utils.h"
+
+#define MAGIC "CLGR"
+#define MAGIC_SIZE 4
+#define VERSION 2
+#define FLAGS_OFFSET 5
+#define FLAG_TICKS 1 // The game ran in fixed ticks, so its keys are replayed at their tick instead of their time
+#define SIZE_OFFSET (FLAGS_OFFSET + 9) // Width and height of the screen, 2 bytes each, 0 until the game starts
+#define HEADER_SIZE (SIZE_OFFSET + 4)
+#define MAX_ARGS 64
+
+// The lowest bits of an event's code tell what it is, the rest hold the key or the cell of the move
+#define EVENT_KEY 0
+#define EVENT_MOVE 1
+#define EVENT_END 2 // Where the session ended, the last event
+#define EVENT_BITS 2
+
+// A key, mouse click or move of the computer, with the tick of the game and the milliseconds since the recording
+// started when it came
+struct event
+{
+    long long tick;
+    double ms;
+    bool move;
+    int value;
+    MEVENT mouse;
+};
+
+static void write_event(uint64_t code);
+static void write_size(int value);
+static void write_varint(uint64_t value);
+static bool read_varint(uint64_t *value);
+static void read_event();
+static bool key_due();
+
+bool record_on = false;
+bool replay_on = false;
+static long long tick;
+static double start;
+static long long last_tick;
+static long long last_ms;
+
+// The file being recorded, which is flushed after every event so a session that's killed still replays
+static FILE *output;
+static bool ticked;
+
+// The recording being replayed, read into memory at the start, and its next event
+static unsigned char *data;
+static size_t data_size;
+static size_t data_pos;
+static struct event next;
+static bool has_next;
+static bool fast;
+static bool ticking;
+static double virtual_ms;
+static bool ended;
+static long long end_tick;
+static double end_ms;
+
+// Start recording the keys of a game into a file. It starts with the seed and the game's name and options, so the
+// recording can play the same game again by itself. The size of the screen is filled in once the game starts
+bool record_start(const char *path, int argc, char *argv[])
+{
+    output = fopen(path, "wb");
+    if (output == NULL)
+    {
+        return false;
+    }
+    fwrite(MAGIC, 1, MAGIC_SIZE, output);
+    fputc(VERSION, output);
+    fputc(0, output);
+    uint64_t seed = rand_get_seed();
+    for (int i = 0; i < 8; i++)
+    {
+        fputc((int) (seed >> (i * 8)) & 0xFF, output);
+    }
+    write_size(0);
+    write_size(0);
+    write_varint(argc);
+    for (int i = 0; i < argc; i++)
+    {
+        write_varint(strlen(argv[i]));
+        fwrite(argv[i], 1, strlen(argv[i]), output);
+    }
+    fflush(output);
+    tick = 0;
+    last_tick = 0;
+    last_ms = 0;
+    ticked = false;
+    start = render_now();
+    record_on = true;
+    atexit(record_stop);
+    return true;
+}
+
+// End the recording with the tick and time the session ended at, so a replay stops where it did
+void record_stop()
+{
+    if (record_on)
+    {
+        write_event(EVENT_END);
+        record_on = false;
+        fclose(output);
+    }
+}
+
+// Keep the size of the screen the game was played on, which a replay needs to draw it the same way
+void record_size(int width, int height)
+{
+    if (record_on)
+    {
+        fseek(output, SIZE_OFFSET, SEEK_SET);
+        write_size(width);
+        write_size(height);
+        fseek(output, 0, SEEK_END);
+        fflush(output);
+    }
+}
+
+// Load a recording and seed the random number generator with its seed. Its game and options are returned, the
+// game's name first. A fast replay doesn't wait for the time between keys to pass
+bool replay_start(const char *path, bool is_fast, int *argc, char ***argv)
+{
+    FILE *input = fopen(path, "rb");
+    if (input == NULL)
+    {
+        return false;
+    }
+    fseek(input, 0, SEEK_END);
+    long size = ftell(input);
+    fseek(input, 0, SEEK_SET);
+    data = malloc(size > 0 ? size : 1);
+    if (data == NULL || size < HEADER_SIZE || fread(data, 1, size, input) != (size_t) size
+        || memcmp(data, MAGIC, MAGIC_SIZE) != 0 || data[MAGIC_SIZE] != VERSION)
+    {
+        fclose(input);
+        return false;
+    }
+    fclose(input);
+    data_size = size;
+    ticking = data[FLAGS_OFFSET] & FLAG_TICKS;
+    uint64_t seed = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        seed |= (uint64_t) data[FLAGS_OFFSET + 1 + i] << (i * 8);
+    }
+    rand_seed(seed);
+
+    data_pos = HEADER_SIZE;
+    uint64_t arg_n, length;
+    if (!read_varint(&arg_n) || arg_n < 1 || arg_n > MAX_ARGS)
+    {
+        return false;
+    }
+    char **args = malloc(sizeof(char *) * arg_n);
+    for (uint64_t i = 0; args != NULL && i < arg_n; i++)
+    {
+        if (!read_varint(&length) || length > data_size - data_pos)
+        {
+            return false;
+        }
+        args[i] = strndup((const char *) data + data_pos, length);
+        data_pos += length;
+    }
+    if (args == NULL)
+    {
+        return false;
+    }
+    *argc = arg_n;
+    *argv = args;
+
+    tick = 0;
+    last_tick = 0;
+    last_ms = 0;
+    fast = is_fast;
+    ended = false;
+    start = now_ms();
+    virtual_ms = start;
+    read_event();
+    replay_on = true;
+    return true;
+}
+
+// Count a tick of a game that runs in fixed ticks
+void record_tick()
+{
+    tick++;
+    if (record_on && !ticked)
+    {
+        ticked = true;
+        fseek(output, FLAGS_OFFSET, SEEK_SET);
+        fputc(FLAG_TICKS, output);
+        fseek(output, 0, SEEK_END);
+    }
+}
+
+void record_key(int key, const MEVENT *mouse)
+{
+    if (!record_on)
+    {
+        return;
+    }
+    write_event(((uint64_t) key << EVENT_BITS) | EVENT_KEY);
+    if (key == KEY_MOUSE)
+    {
+        write_varint(mouse->x);
+        write_varint(mouse->y);
+        write_varint(mouse->bstate);
+    }
+    fflush(output);
+}
+
+// The computer's moves are kept as well, since a search that stops after a time can find another move next time
+void record_move(int cell)
+{
+    if (record_on)
+    {
+        write_event(((uint64_t) cell << EVENT_BITS) | EVENT_MOVE);
+        fflush(output);
+    }
+}
+
+// The next recorded key once it's due, waiting up to timeout_ms for it like render_key(). In a game of ticks a key
+// is due at its tick, and when the game waits for a key without ticks it gets the next one
+int replay_key(double timeout_ms, MEVENT *mouse)
+{
+    bool any_time = ticking && timeout_ms < 0;
+    if (!key_due() && timeout_ms != 0 && !any_time)
+    {
+        replay_wait(timeout_ms);
+    }
+    if (!has_next || next.move || (!key_due() && !any_time))
+    {
+        return ERR;
+    }
+    int key = next.value;
+    *mouse = next.mouse;
+    read_event();
+    return key;
+}
+
+// Let ms pass, for ever if negative, but only until the next key is due in a game without ticks. A fast replay
+// moves its clock on instead of sleeping. Returns false once the recording has run out, so nothing is left to wait
+// for: once the tick and time the session ended at have passed, or at the last key of a recording that was cut short
+bool replay_wait(double ms)
+{
+    double until = ms >= 0 ? replay_now() + ms : INFINITY;
+    if (has_next && !ticking)
+    {
+        until = fmin(until, start + next.ms);
+    }
+    if (!has_next && ended)
+    {
+        // A game of ticks can still wait within its last tick, e.g. for a pause at its end
+        bool last_tick_done = !ticking || tick >= end_tick;
+        if (last_tick_done && replay_now() - start >= end_ms)
+        {
+            return false;
+        }
+        until = last_tick_done ? fmin(until, start + end_ms) : until;
+    }
+    if (until == INFINITY || (!has_next && !ticking && !ended))
+    {
+        return false;
+    }
+    if (fast)
+    {
+        virtual_ms = fmax(virtual_ms, until);
+        return true;
+    }
+    double left = until - now_ms();
+    if (left > 0)
+    {
+        struct timespec wait = { (time_t) (left / 1000), (long) (fmod(left, 1000) * 1e6) };
+        nanosleep(&wait, NULL);
+    }
+    return true;
+}
+
+// Take the computer's next move from the recording once it's due, if that's what comes next
+bool replay_move(int *cell)
+{
+    if (!has_next || !next.move)
+    {
+        return false;
+    }
+    if (!ticking)
+    {
+        replay_wait(-1);
+    }
+    *cell = next.value;
+    read_event();
+    return true;
+}
+
+// The size of the screen the recording was played on, false if the game never started
+bool replay_size(int *width, int *height)
+{
+    *width = data[SIZE_OFFSET] | data[SIZE_OFFSET + 1] << 8;
+    *height = data[SIZE_OFFSET + 2] | data[SIZE_OFFSET + 3] << 8;
+    return *width > 0 && *height > 0;
+}
+
+// The clock of the game being replayed, which only moves when the game waits in a fast replay
+double replay_now()
+{
+    return fast ? virtual_ms : now_ms();
+}
+
+// Every event is three numbers or more, each a varint of 7 bits a byte: the ticks and milliseconds since the last
+// event, and its code, the key or the computer's move shifted left by EVENT_BITS above what it is. A mouse event is
+// followed by its column, row and buttons
+static void write_event(uint64_t code)
+{
+    long long ms = llround(render_now() - start);
+    ms = ms > last_ms ? ms : last_ms;
+    write_varint(tick - last_tick);
+    write_varint(ms - last_ms);
+    write_varint(code);
+    last_tick = tick;
+    last_ms = ms;
+}
+
+static void write_size(int value)
+{
+    value = value > 0 && value <= 0xFFFF ? value : 0;
+    fputc(value & 0xFF, output);
+    fputc(value >> 8, output);
+}
+
+static void write_varint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        fputc((int) (value & 0x7F) | 0x80, output);
+        value >>= 7;
+    }
+    fputc((int) value, output);
+}
+
+static bool read_varint(uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && data_pos < data_size; shift += 7)
+    {
+        unsigned char byte = data[data_pos++];
+        *value |= (uint64_t) (byte & 0x7F) << shift;
+        if (byte < 0x80)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Read the next event, a recording that ends part way through an event ends before it
+static void read_event()
+{
+    uint64_t ticks, ms, code, x, y, buttons;
+    has_next = read_varint(&ticks) && read_varint(&ms) && read_varint(&code);
+    if (!has_next)
+    {
+        return;
+    }
+    last_tick += ticks;
+    last_ms += ms;
+    uint64_t type = code & ((1 << EVENT_BITS) - 1);
+    if (type == EVENT_END)
+    {
+        has_next = false;
+        ended = true;
+        end_tick = last_tick;
+        end_ms = last_ms;
+        return;
+    }
+    next = (struct event) { last_tick, last_ms, type == EVENT_MOVE, (int) (code >> EVENT_BITS), { 0 } };
+    if (!next.move && next.value == KEY_MOUSE)
+    {
+        has_next = read_varint(&x) && read_varint(&y) && read_varint(&buttons);
+        next.mouse = (MEVENT) { 0, (int) x, (int) y, 0, (mmask_t) buttons };
+    }
+}
+
+static bool key_due()
+{
+    return has_next && !next.move && (ticking ? next.tick <= tick : replay_now() - start >= next.ms);
+}
+
@@ -0,0 +1,23 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <ncurses.h>
+#include <stdbool.h>
+
+extern bool record_on;
+extern bool replay_on;
+
+bool record_start(const char *path, int argc, char *argv[]);
+void record_stop();
+void record_size(int width, int height);
+bool replay_start(const char *path, bool fast, int *argc, char ***argv);
+void record_tick();
+void record_key(int key, const MEVENT *mouse);
+void record_move(int cell);
+int replay_key(double timeout_ms, MEVENT *mouse);
+bool replay_wait(double ms);
+bool replay_move(int *cell);
+bool replay_size(int *width, int *height);
+double replay_now();
+
+#endif
@@ -0,0 +1,391 @@
+#define _GNU_SOURCE // For ppoll(), which can sleep for less than a millisecond
+#include "render.h"
+#include "record.h"
+#include "trace.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LINE_SIZE 1024 // Longest text printed in one go
+
+static bool curses_start(bool mouse);
+static void curses_stop();
+static void curses_colour(short pair, short fg, short bg);
+static void curses_size(int *width, int *height);
+static void curses_blank();
+static void curses_put(int x, int y, chtype ch);
+static void curses_present(int cursor_x, int cursor_y);
+static int curses_key();
+static bool curses_mouse(MEVENT *event);
+static bool curses_wait(double ms);
+static void curses_flush();
+static void end_replay();
+
+const struct render_backend render_curses = {
+    .start = curses_start,
+    .stop = curses_stop,
+    .colour = curses_colour,
+    .size = curses_size,
+    .blank = curses_blank,
+    .put = curses_put,
+    .present = curses_present,
+    .key = curses_key,
+    .mouse = curses_mouse,
+    .wait = curses_wait,
+    .flush = curses_flush,
+    .now = now_ms,
+};
+
+// The backend in use, the cursor where text goes next and the attributes it's drawn with
+static const struct render_backend *backend = &render_curses;
+static int cursor_x;
+static int cursor_y;
+static attr_t current_attrs;
+
+// The mouse event of the last KEY_MOUSE, read with the key so it can be recorded with it
+static MEVENT mouse_event;
+static bool mouse_ready;
+
+// Pick the backend before the game starts, the terminal is the default
+void render_use(const struct render_backend *b)
+{
+    backend = b;
+}
+
+// Set up the screen for a game: keys are read one at a time without echoing them, arrow keys and colours work,
+// and the mouse is only captured when the game uses it. A recording keeps the size of the screen, and a replay
+// on a screen of another size would draw a different game, so it stops
+bool render_start(bool mouse)
+{
+    cursor_x = 0;
+    cursor_y = 0;
+    current_attrs = A_NORMAL;
+    if (!backend->start(mouse))
+    {
+        return false;
+    }
+    int width, height, recorded_width, recorded_height;
+    backend->size(&width, &height);
+    record_size(width, height);
+    if (replay_on && replay_size(&recorded_width, &recorded_height)
+        && (width != recorded_width || height != recorded_height))
+    {
+        backend->stop();
+        printf("The recording was played on a %ix%i screen, this one is %ix%i\n", recorded_width, recorded_height,
+               width, height);
+        exit(1);
+    }
+    return true;
+}
+
+void render_stop()
+{
+    backend->stop();
+}
+
+void render_colour(short pair, short fg, short bg)
+{
+    backend->colour(pair, fg, bg);
+}
+
+void render_erase()
+{
+    backend->blank();
+    cursor_x = 0;
+    cursor_y = 0;
+}
+
+// Show the frame, with the terminal's cursor left where the game's cursor is
+void render_present()
+{
+    double start = trace_begin();
+    backend->present(cursor_x, cursor_y);
+    trace_end("refresh", start);
+    trace_frame();
+}
+
+void render_move(int y, int x)
+{
+    cursor_y = y;
+    cursor_x = x;
+}
+
+// Draw a character at the cursor and move it right. Text past the edge of the screen is cut off
+void render_add(chtype ch)
+{
+    backend->put(cursor_x++, cursor_y, ch | current_attrs);
+}
+
+void render_add_at(int y, int x, chtype ch)
+{
+    render_move(y, x);
+    render_add(ch);
+}
+
+void render_print(const char *format, ...)
+{
+    char line[LINE_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    for (const char *c = line; *c != '\0'; c++)
+    {
+        render_add((unsigned char) *c);
+    }
+}
+
+void render_print_at(int y, int x, const char *format, ...)
+{
+    char line[LINE_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    render_move(y, x);
+    render_print("%s", line);
+}
+
+void render_attr_on(attr_t attrs)
+{
+    current_attrs |= attrs;
+}
+
+void render_attr_off(attr_t attrs)
+{
+    current_attrs &= ~attrs;
+}
+
+int render_cursor_y()
+{
+    return cursor_y;
+}
+
+// Read a key, waiting up to timeout_ms for one to come. 0 only looks, and a negative time waits for ever.
+// Returns ERR if no key came
+int render_key(double timeout_ms)
+{
+    if (replay_on)
+    {
+        int key = replay_key(timeout_ms, &mouse_event);
+        mouse_ready = key == KEY_MOUSE && mouse_event.bstate != 0;
+        if (key == ERR && timeout_ms < 0)
+        {
+            end_replay();
+        }
+        return key;
+    }
+    int key = backend->key();
+    while (key == ERR && timeout_ms != 0)
+    {
+        if (!render_wait(timeout_ms))
+        {
+            return ERR;
+        }
+        key = backend->key();
+        if (timeout_ms > 0)
+        {
+            break;
+        }
+    }
+    if (key == KEY_MOUSE)
+    {
+        mouse_ready = backend->mouse(&mouse_event);
+        if (!mouse_ready)
+        {
+            mouse_event.bstate = 0;
+        }
+    }
+    if (key != ERR)
+    {
+        record_key(key, &mouse_event);
+    }
+    return key;
+}
+
+bool render_mouse(MEVENT *event)
+{
+    if (!mouse_ready)
+    {
+        return false;
+    }
+    *event = mouse_event;
+    mouse_ready = false;
+    return true;
+}
+
+// Sleep until a key is pressed or ms pass, for ever if ms is negative. Returns false if waiting failed
+bool render_wait(double ms)
+{
+    double start = trace_begin();
+    bool waited = replay_on ? replay_wait(ms) : backend->wait(ms);
+    trace_record_wait(start);
+    if (!waited && replay_on)
+    {
+        end_replay();
+    }
+    return waited;
+}
+
+// Drop the keys pressed so far. A replay has none, since keys that were dropped weren't recorded
+void render_flush()
+{
+    if (!replay_on)
+    {
+        backend->flush();
+    }
+}
+
+// Milliseconds on the game's clock, which a fast replay and the headless backend move on only as the game waits
+double render_now()
+{
+    if (replay_on)
+    {
+        return replay_now();
+    }
+    return backend->now();
+}
+
+// Sleep until standard input can be read or ms pass, for ever if negative, for the backends that read the terminal.
+// A signal ends the sleep early. Returns false if waiting failed
+bool wait_stdin(double ms)
+{
+    struct pollfd input = { STDIN_FILENO, POLLIN, 0 };
+    struct timespec wait = { (time_t) (ms / 1000), (long) (fmod(ms, 1000) * 1e6) };
+    return ppoll(&input, 1, ms >= 0 ? &wait : NULL, NULL) >= 0 || errno == EINTR;
+}
+
+// Move down or up relative to the current cursor position
+void move_rel_y(int amount)
+{
+    cursor_y += amount;
+}
+
+// Move only the x coordinate of the cursor
+void move_x(int new_x)
+{
+    cursor_x = new_x;
+}
+
+// Move the cursor to the beginning and down by 'lines'
+void new_line(int lines)
+{
+    if (lines < 1)
+    {
+        return;
+    }
+    else
+    {
+        move_x(0);
+        move_rel_y(lines);
+    }
+}
+
+// Returns the width of the window
+int get_width()
+{
+    int width, height;
+    backend->size(&width, &height);
+    return width;
+}
+
+// Returns the height of the window
+int get_height()
+{
+    int width, height;
+    backend->size(&width, &height);
+    return height;
+}
+
+// The session ends when the recording runs out, like the headless backend at the end of its keys
+static void end_replay()
+{
+    backend->stop();
+    exit(0);
+}
+
+static bool curses_start(bool mouse)
+{
+    // Start curses mode the first time. Later games in the same process, e.g. from the hub, come back to the
+    // screen endwin() left without reading the terminal's description again
+    if (stdscr == NULL)
+    {
+        initscr();
+
+        // Disable line buffering
+        cbreak();
+
+        // Don't echo user input
+        noecho();
+
+        // Allow the use of arrow keys, and read keys without waiting for them
+        keypad(stdscr, TRUE);
+        nodelay(stdscr, TRUE);
+
+        // Set up colours
+        start_color();
+        use_default_colors();
+    }
+
+    mousemask(mouse ? ALL_MOUSE_EVENTS | REPORT_MOUSE_POSITION : 0, NULL);
+    return true;
+}
+
+static void curses_stop()
+{
+    endwin();
+}
+
+static void curses_colour(short pair, short fg, short bg)
+{
+    init_pair(pair, fg, bg);
+}
+
+static void curses_size(int *width, int *height)
+{
+    getmaxyx(stdscr, *height, *width);
+}
+
+static void curses_blank()
+{
+    erase();
+}
+
+static void curses_put(int x, int y, chtype ch)
+{
+    mvaddch(y, x, ch);
+}
+
+static void curses_present(int cursor_x, int cursor_y)
+{
+    move(cursor_y, cursor_x);
+    refresh();
+}
+
+static int curses_key()
+{
+    return getch();
+}
+
+static bool curses_mouse(MEVENT *event)
+{
+    return getmouse(event) == OK;
+}
+
+// A resized terminal interrupts the sleep and arrives as KEY_RESIZE
+static bool curses_wait(double ms)
+{
+    return wait_stdin(ms);
+}
+
+static void curses_flush()
+{
+    flushinp();
+}
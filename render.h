@@ -0,0 +1,56 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+// Keys, attributes and colour pairs keep their ncurses values whichever backend draws the game
+#include <ncurses.h>
+#include <stdbool.h>
+
+// Where the games draw and read keys from. Cells are written one at a time with their attributes, and nothing
+// has to show until the frame is presented
+struct render_backend
+{
+    bool (*start)(bool mouse);
+    void (*stop)();
+    void (*colour)(short pair, short fg, short bg);
+    void (*size)(int *width, int *height);
+    void (*blank)();                 // Clear every cell
+    void (*put)(int x, int y, chtype ch);
+    void (*present)(int cursor_x, int cursor_y);
+    int (*key)();                    // The next key, or ERR without waiting if there is none
+    bool (*mouse)(MEVENT *event);    // The event of the last KEY_MOUSE
+    bool (*wait)(double ms);         // Sleep until a key comes or ms pass, for ever if negative
+    void (*flush)();                 // Drop the keys pressed so far
+    double (*now)();                 // Milliseconds on the backend's clock
+};
+
+extern const struct render_backend render_curses;
+extern const struct render_backend render_headless;
+extern const struct render_backend render_ansi;
+
+void render_use(const struct render_backend *backend);
+bool render_start(bool mouse);
+void render_stop();
+void render_colour(short pair, short fg, short bg);
+void render_erase();
+void render_present();
+void render_move(int y, int x);
+void render_add(chtype ch);
+void render_add_at(int y, int x, chtype ch);
+void render_print(const char *format, ...);
+void render_print_at(int y, int x, const char *format, ...);
+void render_attr_on(attr_t attrs);
+void render_attr_off(attr_t attrs);
+int render_cursor_y();
+int render_key(double timeout_ms);
+bool render_mouse(MEVENT *event);
+bool render_wait(double ms);
+void render_flush();
+double render_now();
+bool wait_stdin(double ms);
+void move_rel_y(int rows);
+void move_x(int new_x);
+void new_line(int lines);
+int get_width();
+int get_height();
+
+#endif
@@ -0,0 +1,561 @@
+#include "render.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define ESC 27
+#define DEL 127
+#define PAIRS 256
+#define INPUT_SIZE 256
+#define FIRST_OUTPUT 4096
+#define SHOWN_ATTRS (A_BOLD | A_UNDERLINE | A_REVERSE | A_COLOR) // The attributes drawn, the others are ignored
+#define MAX_REWRITE 3 // Unchanged cells written again to move the cursor right, a shorter jump than an escape sequence
+#define ESC_TIMEOUT_MS 100 // How long the rest of an escape sequence split across reads is waited for
+
+static bool ansi_start(bool mouse);
+static void ansi_stop();
+static void ansi_colour(short pair, short fg, short bg);
+static void ansi_size(int *width, int *height);
+static void ansi_blank();
+static void ansi_put(int x, int y, chtype ch);
+static void ansi_present(int cursor_x, int cursor_y);
+static int ansi_key();
+static bool ansi_mouse(MEVENT *event);
+static bool ansi_wait(double ms);
+static void ansi_flush();
+static bool fit_screen();
+static void move_to(int x, int y);
+static void set_attrs(attr_t attrs);
+static void add_colour(char *sgr, int *n, int base, short colour);
+static char shown_char(chtype ch);
+static void output(const char *bytes, size_t n);
+static void write_output();
+static int decode_key();
+static bool partial_escape();
+static void on_resize(int sig);
+static void on_quit(int sig);
+
+// Draws with escape sequences written straight to the terminal instead of through ncurses. The game draws into a
+// back buffer, and presenting a frame compares it with the front buffer, which holds what the terminal shows, and
+// sends only the cells that changed with the shortest cursor moves and colour changes that get there, in one
+// write(). Over a slow connection, the bytes sent are what the player waits for, and the average and largest
+// frame are printed when the game ends
+const struct render_backend render_ansi = {
+    .start = ansi_start,
+    .stop = ansi_stop,
+    .colour = ansi_colour,
+    .size = ansi_size,
+    .blank = ansi_blank,
+    .put = ansi_put,
+    .present = ansi_present,
+    .key = ansi_key,
+    .mouse = ansi_mouse,
+    .wait = ansi_wait,
+    .flush = ansi_flush,
+    .now = now_ms,
+};
+
+// The screen as the game drew it and as the terminal shows it, and where the terminal's cursor is (-1 if unknown)
+static chtype *back;
+static chtype *front;
+static int width;
+static int height;
+static int term_x;
+static int term_y;
+static attr_t drawn_attrs;
+static bool clear_screen;
+
+static short pair_fg[PAIRS];
+static short pair_bg[PAIRS];
+static bool mouse_on;
+static struct termios saved_termios;
+static volatile sig_atomic_t resized;
+
+// Bytes read but not yet turned into keys, and the last mouse click. An escape sequence that has only partly
+// arrived is kept until the rest comes, or taken as ESC and the keys after it if it doesn't come in time
+static unsigned char input[INPUT_SIZE];
+static int input_n;
+static bool escape_waiting;
+static double escape_since;
+static MEVENT mouse_event;
+
+// Bytes of the frame being sent, and how many were sent over the whole game
+static char *out;
+static size_t out_n;
+static size_t out_capacity;
+static long long frames;
+static long long total_bytes;
+static size_t max_bytes;
+
+static bool ansi_start(bool mouse)
+{
+    // Read keys one at a time without echoing them, without waiting for them, and send new lines as they are.
+    // Ctrl-C still quits
+    if (tcgetattr(STDIN_FILENO, &saved_termios) != 0)
+    {
+        return false;
+    }
+    struct termios raw = saved_termios;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_oflag &= ~ONLCR;
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+    // A resized terminal interrupts waiting for a key and arrives as KEY_RESIZE
+    struct sigaction action = { 0 };
+    action.sa_handler = on_resize;
+    sigaction(SIGWINCH, &action, NULL);
+    action.sa_handler = on_quit;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    for (int i = 0; i < PAIRS; i++)
+    {
+        pair_fg[i] = -1;
+        pair_bg[i] = -1;
+    }
+    mouse_on = mouse;
+    resized = 0;
+    input_n = 0;
+    escape_waiting = false;
+    frames = 0;
+    total_bytes = 0;
+    max_bytes = 0;
+    out_n = 0;
+
+    // Switch to the alternate screen, so the terminal is left as it was when the game ends. Clicks are reported
+    // with their coordinates in decimal, which works on screens of any size
+    const char *enter = mouse ? "\x1b[?1049h\x1b[?1000h\x1b[?1006h" : "\x1b[?1049h";
+    output(enter, strlen(enter));
+    return fit_screen();
+}
+
+static void ansi_stop()
+{
+    const char *leave = mouse_on ? "\x1b[0m\x1b[?1006l\x1b[?1000l\x1b[?1049l" : "\x1b[0m\x1b[?1049l";
+    output(leave, strlen(leave));
+    write_output();
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+    signal(SIGWINCH, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    if (frames > 0)
+    {
+        printf("Terminal output: %.0f bytes per frame on average, %zu at most over %lli frames\n",
+               (double) total_bytes / frames, max_bytes, frames);
+    }
+    free(back);
+    free(front);
+    free(out);
+    back = NULL;
+    front = NULL;
+    out = NULL;
+    out_capacity = 0;
+}
+
+// Colours are sent as the terminal's own palette of 8, -1 is the terminal's default
+static void ansi_colour(short pair, short fg, short bg)
+{
+    if (pair > 0 && pair < PAIRS)
+    {
+        pair_fg[pair] = fg;
+        pair_bg[pair] = bg;
+    }
+}
+
+static void ansi_size(int *w, int *h)
+{
+    *w = width;
+    *h = height;
+}
+
+static void ansi_blank()
+{
+    for (int i = 0; i < width * height; i++)
+    {
+        back[i] = ' ';
+    }
+}
+
+static void ansi_put(int x, int y, chtype ch)
+{
+    if (x >= 0 && y >= 0 && x < width && y < height)
+    {
+        back[y * width + x] = ch;
+    }
+}
+
+// Send the cells that differ from what the terminal shows, going along each row
+static void ansi_present(int cursor_x, int cursor_y)
+{
+    if (clear_screen)
+    {
+        output("\x1b[0m\x1b[2J", 8);
+        drawn_attrs = A_NORMAL;
+        term_x = -1;
+        term_y = -1;
+        clear_screen = false;
+    }
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            chtype ch = back[y * width + x] & (A_CHARTEXT | SHOWN_ATTRS);
+            if (ch == front[y * width + x])
+            {
+                continue;
+            }
+            move_to(x, y);
+            set_attrs(ch & SHOWN_ATTRS);
+            char c = shown_char(ch);
+            output(&c, 1);
+            front[y * width + x] = ch;
+
+            // Where the cursor goes after the last column differs between terminals
+            term_x = x + 1 < width ? x + 1 : -1;
+        }
+    }
+    if (cursor_x >= 0 && cursor_y >= 0 && cursor_x < width && cursor_y < height)
+    {
+        move_to(cursor_x, cursor_y);
+    }
+
+    frames++;
+    total_bytes += out_n;
+    max_bytes = out_n > max_bytes ? out_n : max_bytes;
+    write_output();
+}
+
+static int ansi_key()
+{
+    if (resized)
+    {
+        resized = 0;
+        fit_screen();
+        return KEY_RESIZE;
+    }
+    if (input_n < INPUT_SIZE)
+    {
+        ssize_t n = read(STDIN_FILENO, input + input_n, INPUT_SIZE - input_n);
+        input_n += n > 0 ? n : 0;
+    }
+    int key = ERR;
+    while (input_n > 0 && key == ERR)
+    {
+        if (partial_escape() && input_n < INPUT_SIZE)
+        {
+            if (!escape_waiting)
+            {
+                escape_waiting = true;
+                escape_since = now_ms();
+            }
+            if (now_ms() - escape_since < ESC_TIMEOUT_MS)
+            {
+                return ERR;
+            }
+        }
+        escape_waiting = false;
+        key = decode_key();
+    }
+    return key;
+}
+
+static bool ansi_mouse(MEVENT *event)
+{
+    if (mouse_event.bstate == 0)
+    {
+        return false;
+    }
+    *event = mouse_event;
+    mouse_event.bstate = 0;
+    return true;
+}
+
+// Bytes waiting to be decoded don't need a sleep, unless they're the start of an escape sequence, which only needs
+// the rest of it or its timeout
+static bool ansi_wait(double ms)
+{
+    if ((input_n > 0 && !escape_waiting) || resized)
+    {
+        return true;
+    }
+    if (escape_waiting)
+    {
+        double left = escape_since + ESC_TIMEOUT_MS - now_ms();
+        left = left > 0 ? left : 0;
+        ms = ms >= 0 && ms < left ? ms : left;
+    }
+    return wait_stdin(ms);
+}
+
+static void ansi_flush()
+{
+    tcflush(STDIN_FILENO, TCIFLUSH);
+    input_n = 0;
+    escape_waiting = false;
+}
+
+// Size the buffers to the terminal, and have the next frame start from a cleared screen
+static bool fit_screen()
+{
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_col == 0 || size.ws_row == 0)
+    {
+        size.ws_col = 80;
+        size.ws_row = 24;
+    }
+    chtype *new_back = realloc(back, sizeof(chtype) * size.ws_col * size.ws_row);
+    if (new_back == NULL)
+    {
+        return false;
+    }
+    back = new_back;
+    chtype *new_front = realloc(front, sizeof(chtype) * size.ws_col * size.ws_row);
+    if (new_front == NULL)
+    {
+        return false;
+    }
+    front = new_front;
+    width = size.ws_col;
+    height = size.ws_row;
+    for (int i = 0; i < width * height; i++)
+    {
+        back[i] = ' ';
+        front[i] = ' ';
+    }
+    clear_screen = true;
+    return true;
+}
+
+// Move the terminal's cursor with the fewest bytes: nothing, the unchanged cells in between written again, a jump
+// right, a new line or a jump to the row and column
+static void move_to(int x, int y)
+{
+    if (term_x == x && term_y == y)
+    {
+        return;
+    }
+    char sequence[32];
+    int n;
+    if (term_y == y && term_x >= 0 && x > term_x)
+    {
+        int gap = x - term_x;
+        bool same_attrs = true;
+        for (int i = term_x; i < x && same_attrs; i++)
+        {
+            same_attrs = (front[y * width + i] & SHOWN_ATTRS) == drawn_attrs;
+        }
+        if (gap <= MAX_REWRITE && same_attrs)
+        {
+            for (int i = term_x; i < x; i++)
+            {
+                char c = shown_char(front[y * width + i]);
+                output(&c, 1);
+            }
+            term_x = x;
+            return;
+        }
+        n = gap == 1 ? snprintf(sequence, sizeof(sequence), "\x1b[C") : snprintf(sequence, sizeof(sequence), "\x1b[%iC", gap);
+    }
+    else if (x == 0 && term_y >= 0 && y == term_y + 1)
+    {
+        n = snprintf(sequence, sizeof(sequence), "\r\n");
+    }
+    else if (x == 0 && y == 0)
+    {
+        n = snprintf(sequence, sizeof(sequence), "\x1b[H");
+    }
+    else
+    {
+        n = snprintf(sequence, sizeof(sequence), "\x1b[%i;%iH", y + 1, x + 1);
+    }
+    output(sequence, n);
+    term_x = x;
+    term_y = y;
+}
+
+// Change only the attributes that differ from the ones the terminal draws with now
+static void set_attrs(attr_t attrs)
+{
+    if (attrs == drawn_attrs)
+    {
+        return;
+    }
+    char sgr[64] = "\x1b[";
+    int n = 2;
+    static const attr_t STYLES[] = { A_BOLD, A_UNDERLINE, A_REVERSE };
+    static const char *STYLE_ON[] = { "1;", "4;", "7;" };
+    static const char *STYLE_OFF[] = { "22;", "24;", "27;" };
+    for (int i = 0; i < 3; i++)
+    {
+        if ((attrs & STYLES[i]) != (drawn_attrs & STYLES[i]))
+        {
+            const char *code = attrs & STYLES[i] ? STYLE_ON[i] : STYLE_OFF[i];
+            n += snprintf(sgr + n, sizeof(sgr) - n, "%s", code);
+        }
+    }
+    int pair = PAIR_NUMBER(attrs);
+    int term_pair = PAIR_NUMBER(drawn_attrs);
+    if (pair_fg[pair] != pair_fg[term_pair])
+    {
+        add_colour(sgr, &n, 30, pair_fg[pair]);
+    }
+    if (pair_bg[pair] != pair_bg[term_pair])
+    {
+        add_colour(sgr, &n, 40, pair_bg[pair]);
+    }
+    drawn_attrs = attrs;
+    if (n == 2)
+    {
+        return;
+    }
+    sgr[n - 1] = 'm';
+    output(sgr, n);
+}
+
+static void add_colour(char *sgr, int *n, int base, short colour)
+{
+    *n += snprintf(sgr + *n, 64 - *n, "%i;", colour >= 0 && colour < 8 ? base + colour : base + 9);
+}
+
+// Characters the terminal might not draw in a single cell are shown as '?'
+static char shown_char(chtype ch)
+{
+    chtype c = ch & A_CHARTEXT;
+    return c >= ' ' && c < DEL ? (char) c : '?';
+}
+
+static void output(const char *bytes, size_t n)
+{
+    if (out_n + n > out_capacity)
+    {
+        size_t capacity = out_capacity > 0 ? out_capacity : FIRST_OUTPUT;
+        while (capacity < out_n + n)
+        {
+            capacity *= 2;
+        }
+        char *grown = realloc(out, capacity);
+        if (grown == NULL)
+        {
+            return;
+        }
+        out = grown;
+        out_capacity = capacity;
+    }
+    memcpy(out + out_n, bytes, n);
+    out_n += n;
+}
+
+static void write_output()
+{
+    size_t sent = 0;
+    while (sent < out_n)
+    {
+        ssize_t n = write(STDOUT_FILENO, out + sent, out_n - sent);
+        if (n < 0 && errno != EINTR)
+        {
+            break;
+        }
+        sent += n > 0 ? n : 0;
+    }
+    out_n = 0;
+}
+
+// Take one key from the bytes read: the escape sequences of the arrow keys and of mouse clicks are turned into
+// KEY_UP and the rest. Presses and other mouse events are skipped, returning ERR
+static int decode_key()
+{
+    int used = 1;
+    int key = input[0];
+    if (key == DEL || key == '\b')
+    {
+        key = KEY_BACKSPACE;
+    }
+    else if (key == ESC && input_n >= 3 && (input[1] == '[' || input[1] == 'O') && input[2] >= 'A' && input[2] <= 'D')
+    {
+        static const int ARROWS[] = { KEY_UP, KEY_DOWN, KEY_RIGHT, KEY_LEFT };
+        key = ARROWS[input[2] - 'A'];
+        used = 3;
+    }
+    else if (key == ESC && input_n >= 3 && input[1] == '[' && input[2] == '<')
+    {
+        // A click is sent as ESC [ < button ; x ; y, ending in M when pressed and m when released
+        int end = 3;
+        while (end < input_n && input[end] != 'M' && input[end] != 'm')
+        {
+            end++;
+        }
+        int button, x, y;
+        if (end < input_n && sscanf((const char *) input + 3, "%i;%i;%i", &button, &x, &y) == 3)
+        {
+            used = end + 1;
+            key = ERR;
+            static const mmask_t CLICKS[] = { BUTTON1_CLICKED, BUTTON2_CLICKED, BUTTON3_CLICKED };
+            if (input[end] == 'm' && (button & ~3) == 0 && button < 3)
+            {
+                mouse_event = (MEVENT) { 0, x - 1, y - 1, 0, CLICKS[button] };
+                key = KEY_MOUSE;
+            }
+        }
+    }
+    input_n -= used;
+    memmove(input, input + used, input_n);
+    return key;
+}
+
+// Whether the bytes read start with ESC and could be the start of an arrow key or a click that hasn't all come yet
+static bool partial_escape()
+{
+    if (input[0] != ESC)
+    {
+        return false;
+    }
+    if (input_n == 1)
+    {
+        return true;
+    }
+    if (input[1] != '[' && input[1] != 'O')
+    {
+        return false;
+    }
+    if (input_n == 2)
+    {
+        return true;
+    }
+    if (input[1] != '[' || input[2] != '<')
+    {
+        return false;
+    }
+    for (int i = 3; i < input_n; i++)
+    {
+        if (input[i] == 'M' || input[i] == 'm')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void on_resize(int sig)
+{
+    (void) sig;
+    resized = 1;
+}
+
+// Give the terminal back before quitting, as ncurses does
+static void on_quit(int sig)
+{
+    const char leave[] = "\x1b[0m\x1b[?1006l\x1b[?1000l\x1b[?1049l";
+    write(STDOUT_FILENO, leave, sizeof(leave) - 1);
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
@@ -0,0 +1,218 @@
+#include "render.h"
+#include "record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HEADLESS_WIDTH 80
+#define HEADLESS_HEIGHT 24
+#define ESC 27
+#define DEL 127
+
+static bool headless_start(bool mouse);
+static void headless_stop();
+static void headless_colour(short pair, short fg, short bg);
+static void headless_size(int *width, int *height);
+static void headless_blank();
+static void headless_put(int x, int y, chtype ch);
+static void headless_present(int cursor_x, int cursor_y);
+static int headless_key();
+static bool headless_mouse(MEVENT *event);
+static bool headless_wait(double ms);
+static void headless_flush();
+static double headless_now();
+static int read_key();
+static void print_frame();
+
+// Draws into a framebuffer in memory instead of the terminal, so a game's real drawing and input code can run
+// without one. Keys are read from standard input, one for each frame the game presents or each time it waits for
+// a key, and the escape sequences of the arrow keys are turned into KEY_UP and the rest. The framebuffer is 80x24,
+// or the size of the screen a replayed recording was played on. Its clock only moves when the game waits, so the
+// game runs as fast as it can draw. When the keys run out the session ends and the last frame is printed
+const struct render_backend render_headless = {
+    .start = headless_start,
+    .stop = headless_stop,
+    .colour = headless_colour,
+    .size = headless_size,
+    .blank = headless_blank,
+    .put = headless_put,
+    .present = headless_present,
+    .key = headless_key,
+    .mouse = headless_mouse,
+    .wait = headless_wait,
+    .flush = headless_flush,
+    .now = headless_now,
+};
+
+static chtype *cells;
+static int width;
+static int height;
+static long long frames;
+static bool key_ready; // Whether the game has presented a frame or waited since the last key
+static double clock_ms;
+
+static bool headless_start(bool mouse)
+{
+    (void) mouse;
+    int new_width, new_height;
+    if (!replay_on || !replay_size(&new_width, &new_height))
+    {
+        new_width = HEADLESS_WIDTH;
+        new_height = HEADLESS_HEIGHT;
+    }
+    if (cells == NULL || new_width != width || new_height != height)
+    {
+        chtype *new_cells = realloc(cells, sizeof(chtype) * new_width * new_height);
+        if (new_cells == NULL)
+        {
+            return false;
+        }
+        cells = new_cells;
+        width = new_width;
+        height = new_height;
+    }
+    headless_blank();
+    frames = 0;
+    key_ready = false;
+    return true;
+}
+
+static void headless_stop()
+{
+    print_frame();
+}
+
+static void headless_colour(short pair, short fg, short bg)
+{
+    (void) pair;
+    (void) fg;
+    (void) bg;
+}
+
+static void headless_size(int *w, int *h)
+{
+    *w = width;
+    *h = height;
+}
+
+static void headless_blank()
+{
+    for (int i = 0; i < width * height; i++)
+    {
+        cells[i] = ' ';
+    }
+}
+
+static void headless_put(int x, int y, chtype ch)
+{
+    if (x >= 0 && y >= 0 && x < width && y < height)
+    {
+        cells[y * width + x] = ch;
+    }
+}
+
+static void headless_present(int cursor_x, int cursor_y)
+{
+    (void) cursor_x;
+    (void) cursor_y;
+    frames++;
+    key_ready = true;
+}
+
+static int headless_key()
+{
+    if (!key_ready)
+    {
+        return ERR;
+    }
+    key_ready = false;
+    int key = read_key();
+    if (key == EOF)
+    {
+        print_frame();
+        exit(0);
+    }
+    return key;
+}
+
+static bool headless_mouse(MEVENT *event)
+{
+    (void) event;
+    return false;
+}
+
+// Waiting for ever lets the next key through, otherwise the clock moves on by ms unless a key is ready
+static bool headless_wait(double ms)
+{
+    if (ms < 0 || key_ready)
+    {
+        key_ready = true;
+        return true;
+    }
+    clock_ms += ms;
+    return true;
+}
+
+// The key of the frame shown is dropped, the next one comes with the next frame or wait
+static void headless_flush()
+{
+    key_ready = false;
+}
+
+static double headless_now()
+{
+    return clock_ms;
+}
+
+static int read_key()
+{
+    int key = getchar();
+    if (key == DEL || key == '\b')
+    {
+        return KEY_BACKSPACE;
+    }
+    if (key != ESC)
+    {
+        return key;
+    }
+    int next = getchar();
+    if (next != '[' && next != 'O')
+    {
+        ungetc(next, stdin);
+        return ESC;
+    }
+    switch (getchar())
+    {
+        case 'A':
+        return KEY_UP;
+
+        case 'B':
+        return KEY_DOWN;
+
+        case 'C':
+        return KEY_RIGHT;
+
+        case 'D':
+        return KEY_LEFT;
+    }
+    return ESC;
+}
+
+// Print the characters of the framebuffer without their attributes, leaving out the spaces at the end of each row
+static void print_frame()
+{
+    for (int y = 0; y < height; y++)
+    {
+        int end = width;
+        while (end > 0 && (cells[y * width + end - 1] & A_CHARTEXT) == ' ')
+        {
+            end--;
+        }
+        for (int x = 0; x < end; x++)
+        {
+            putchar((int) (cells[y * width + x] & A_CHARTEXT));
+        }
+        putchar('\n');
+    }
+    printf("Frames: %lli\n", frames);
+}
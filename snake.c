@@ -1,276 +1,708 @@
 #include "snake.h"
 
-#include <math.h>
-#include <ncurses.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "render.h"
+#include "snakearena.h"
+#include "snakegame.h"
+#include "record.h"
+#include "snakepilot.h"
+#include "trace.h"
 #include "utils.h"
 
-#define MAX_LENGTH 100
-#define MAX_WIDTH get_width()
-#define MAX_HEIGHT get_height()
-#define SPEED 64
+#define TICK_MS 16.0     // The simulation always advances in steps of this length
+#define MOVE_TICKS_X 4   // Ticks between two moves, moving up or down is slower since cells are taller than wide
+#define MOVE_TICKS_Y 7
+#define FRAME_MS 16.0    // Shortest time between two frames
+#define MAX_CATCH_UP 8   // Ticks run in a row after falling behind, any more are dropped. A replay runs one at a
+                         // time, so its keys come between the same ticks they were pressed between
+#define GAME_OVER_MS 320 // Keys are ignored for a moment after the game ends, so a late key doesn't close it
+#define HEADLESS_WIDTH 80
+#define HEADLESS_HEIGHT 24
+#define ARENA_WIDTH 1024
+#define ARENA_HEIGHT 512
+#define MAX_PLAYERS 2    // Sharing the keyboard, one on WASD and one on the arrow keys
 #define CH_WALL '#'
 #define CH_SNAKE '0'
 #define CH_FOOD '@'
+#define CH_OTHER 'o' // Snakes of the arena other than the player's own
 
-static void update();
+// How late the ticks ran compared to when they were due
+struct jitter
+{
+    long long ticks;
+    long long dropped;
+    double total_ms;
+    double max_ms;
+};
+
+static int play();
+static int run_headless(long long ticks, int width, int height);
+static int play_arena(int snake_n, int player_n, int width, int height);
+static int run_arena_headless(long long ticks, int snake_n, int width, int height);
+static bool start_game(int width, int height);
+static void end_game();
+static bool tick(int *move_ticks);
+static void wander(struct snake_game *g);
+static void handle_key(int key);
+static void handle_arena_key(int key, int player_n);
 void print_level();
-void set_direction(int x, int y);
-bool spawn_food();
+static void print_cell(int x, int y);
+static void print_game_over();
+static void print_arena(int player_n);
+static void print_view(int player, int left, int width);
 
+static struct snake_game game;
 static bool should_update;
-static bool game_end;
-static int input;
-int score;
-int game_end_update;
-
-int snake_x[MAX_LENGTH];
-int snake_y[MAX_LENGTH];
-int snake_length;
-int snake_dir_x;
-int snake_dir_y;
-bool should_grow;
-
-int food_x;
-int food_y;
-bool should_spawn_food;
-
-void snake()
+
+// Steers the snake instead of the keys, or instead of wandering without a terminal
+static bool autopilot;
+static struct pilot pilot;
+
+// The arena is played instead of a single game when it's asked for, each player's view follows their snake
+static struct arena arena;
+static int view_x[MAX_PLAYERS];
+static int view_y[MAX_PLAYERS];
+
+// Only the cells that changed are drawn, the whole screen is drawn again when the terminal is resized
+static int screen_w;
+static int screen_h;
+static bool should_print_all;
+
+int snake(int argc, char *argv[])
+{
+    long long headless = 0;
+    int arena_bots = 0;
+    int player_n = 1;
+    int width = 0;
+    int height = 0;
+    autopilot = false;
+    for (int i = 0; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc)
+        {
+            headless = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--size") == 0 && i + 2 < argc)
+        {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--autopilot") == 0)
+        {
+            autopilot = true;
+        }
+        else if (strcmp(argv[i], "--arena") == 0 && i + 1 < argc)
+        {
+            arena_bots = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc)
+        {
+            player_n = atoi(argv[++i]);
+        }
+        else
+        {
+            printf("Usage: ./play snake [--autopilot] [--arena bots [--players 1-2]] [--headless ticks] [--size width height]\n");
+            return 1;
+        }
+    }
+    if (player_n < 1 || player_n > MAX_PLAYERS)
+    {
+        printf("The arena takes 1 to %i players\n", MAX_PLAYERS);
+        return 1;
+    }
+    if (arena_bots > 0)
+    {
+        width = width > 0 ? width : ARENA_WIDTH;
+        height = height > 0 ? height : ARENA_HEIGHT;
+        return headless > 0 ? run_arena_headless(headless, arena_bots, width, height)
+                            : play_arena(arena_bots + player_n, player_n, width, height);
+    }
+    width = width > 0 ? width : HEADLESS_WIDTH;
+    height = height > 0 ? height : HEADLESS_HEIGHT;
+    return headless > 0 ? run_headless(headless, width, height) : play();
+}
+
+// Simulate at a fixed rate on the monotonic clock, and draw the changes at most once a frame. When a tick
+// is due, the loop sleeps until then or until a key is pressed
+static int play()
 {
-    // Allow game to start
+    // Start drawing
+    render_start(false);
+
+    // Initialise the game on the whole screen
+    screen_w = get_width();
+    screen_h = get_height();
+    if (!start_game(screen_w, screen_h))
+    {
+        render_stop();
+        printf("Not enough memory for a %ix%i field\n", screen_w, screen_h);
+        return 1;
+    }
     should_update = true;
-    game_end = false;
-    game_end_update = 0;
+    should_print_all = true;
 
-    // Start curses mode
-    initscr();
+    struct jitter jitter = { 0, 0, 0, 0 };
+    int move_ticks = 0;
+    double next_tick = render_now();
+    double last_frame = next_tick - FRAME_MS;
+    while (should_update && !game.over)
+    {
+        double start = trace_begin();
+        int key;
+        while ((key = render_key(0)) != ERR)
+        {
+            handle_key(key);
+        }
 
-    // Disable line buffering
-    cbreak();
+        // Run every tick that is due, a tick that is very late is dropped rather than run in a burst
+        double now = render_now();
+        for (int ran = 0; now >= next_tick && ran < (replay_on ? 1 : MAX_CATCH_UP) && should_update; ran++)
+        {
+            double late = now - next_tick;
+            jitter.ticks++;
+            jitter.total_ms += late;
+            jitter.max_ms = late > jitter.max_ms ? late : jitter.max_ms;
+            if (autopilot && move_ticks == 0)
+            {
+                pilot_steer(&pilot, &game);
+            }
+            tick(&move_ticks);
+            record_tick();
+            next_tick += TICK_MS;
+        }
+        while (now >= next_tick)
+        {
+            jitter.dropped++;
+            next_tick += TICK_MS;
+        }
+        trace_end("update", start);
 
-    // Don't echo user input
-    noecho();
+        // Draw what changed, unless the last frame was too recent
+        bool changed = should_print_all || game.changed_n > 0 || game.changed_all;
+        double wake = next_tick;
+        if (changed && now - last_frame >= FRAME_MS)
+        {
+            start = trace_begin();
+            print_level();
+            trace_end("render", start);
+            render_present();
+            last_frame = now;
+        }
+        else if (changed)
+        {
+            wake = last_frame + FRAME_MS < wake ? last_frame + FRAME_MS : wake;
+        }
+
+        // Sleep until the next tick or frame is due, or until a key is pressed
+        double wait_ms = wake - render_now();
+        if (!render_wait(wait_ms > 0 ? wait_ms : 0))
+        {
+            break;
+        }
+    }
+    print_level();
+    print_game_over();
 
-    // Allow the use of arrow keys
-    keypad(stdscr, TRUE);
+    render_stop();
+    printf("Score: %i\n", game.score);
+    if (jitter.ticks > 0)
+    {
+        printf("Tick jitter: %.3f ms average, %.3f ms max over %lli ticks, %lli dropped\n",
+               jitter.total_ms / jitter.ticks, jitter.max_ms, jitter.ticks, jitter.dropped);
+    }
+    printf("Seed: %llu\n", (unsigned long long) rand_get_seed());
+    end_game();
+    return 0;
+}
 
-    // Initialise snake
-    snake_length = 1;
-    snake_x[0] = MAX_WIDTH / 2;
-    snake_y[0] = MAX_HEIGHT / 2;
-    snake_dir_x = rand_range(-1, 1);
-    if (snake_dir_x == 0)
+// Run the simulation as fast as possible without a terminal, steering the snake randomly away from walls or with
+// the autopilot. A new game starts whenever the snake dies, fills the field or goes too long without eating
+static int run_headless(long long ticks, int width, int height)
+{
+    if (!start_game(width, height))
     {
-        do
+        printf("Invalid field: %ix%i\n", width, height);
+        return 1;
+    }
+    long long moves = 0;
+    long long games = 0;
+    long long total_score = 0;
+    long long decisions = 0;
+    double decision_ms = 0;
+    double max_decision_ms = 0;
+    double total_fill = 0;
+    long long hungry_moves = 0;
+    int last_score = 0;
+    int inside = (width - 2) * (height - 2);
+    int move_ticks = 0;
+    double start = now_ms();
+    for (long long t = 0; t < ticks; t++)
+    {
+        if (move_ticks == 0 && autopilot)
+        {
+            double before = now_ms();
+            pilot_steer(&pilot, &game);
+            double took = now_ms() - before;
+            decisions++;
+            decision_ms += took;
+            max_decision_ms = took > max_decision_ms ? took : max_decision_ms;
+        }
+        else if (move_ticks == 0)
         {
-            snake_dir_y = rand_range(-1, 1);
-        } while (snake_dir_y == 0);
+            wander(&game);
+        }
+        if (tick(&move_ticks))
+        {
+            moves++;
+            hungry_moves = game.score != last_score ? 0 : hungry_moves + 1;
+            last_score = game.score;
+        }
+        game_clear_changes(&game);
+
+        // The autopilot reaches any food on its cycle within one lap, so a snake that takes two laps is stuck
+        bool stuck = hungry_moves > 2 * (long long) inside;
+        if (game.over || game.food_x < 0 || stuck)
+        {
+            games++;
+            total_score += game.score;
+            total_fill += (double) game.body.length / inside;
+            end_game();
+            if (!start_game(width, height))
+            {
+                printf("Not enough memory for a %ix%i field\n", width, height);
+                return 1;
+            }
+            move_ticks = 0;
+            hungry_moves = 0;
+            last_score = 0;
+        }
     }
-    else
+    double elapsed = (now_ms() - start) / 1000;
+
+    printf("%lli ticks on a %ix%i field in %.3fs\n", ticks, width, height, elapsed);
+    printf("Ticks/second: %.0f\n", elapsed > 0 ? ticks / elapsed : 0);
+    printf("Moves/second: %.0f\n", elapsed > 0 ? moves / elapsed : 0);
+    printf("Games: %lli finished, average score %.2f\n", games, games > 0 ? (double) total_score / games : 0);
+    if (autopilot)
     {
-        snake_dir_y = 0;
+        // Include the unfinished game, so runs too short to finish one still say how far the snake got
+        double fill = (total_fill + (double) game.body.length / inside) / (games + 1);
+        printf("Decisions/second: %.0f, %.3f us average, %.3f us max\n",
+               decision_ms > 0 ? decisions / (decision_ms / 1000) : 0,
+               decisions > 0 ? decision_ms * 1000 / decisions : 0, max_decision_ms * 1000);
+        printf("Average fill: %.2f%%\n", fill * 100);
     }
-    if (snake_dir_y != 0) { timeout(SPEED * 1.75); }
-    else { timeout(SPEED); }
-    should_grow = false;
-    should_spawn_food = true;
-    score = 0;
+    printf("Seed: %llu\n", (unsigned long long) rand_get_seed());
+    end_game();
+    return 0;
+}
 
-    while (should_update)
+// Set up a game on a field of the given size, along with the autopilot if it's used
+static bool start_game(int width, int height)
+{
+    if (!game_init(&game, width, height))
     {
-        erase();
-        print_level();
-        update();
-        refresh();
+        return false;
     }
+    if (autopilot && !pilot_init(&pilot, &game))
+    {
+        game_free(&game);
+        return false;
+    }
+    return true;
+}
 
-    endwin();
+static void end_game()
+{
+    if (autopilot)
+    {
+        pilot_free(&pilot);
+    }
+    game_free(&game);
 }
 
-static void update()
+// Play in the arena with the bots, each player's view is a column of the screen. The timing works like a single
+// game, but every frame is drawn in full since the views move with the snakes and the bots move all the time
+static int play_arena(int snake_n, int player_n, int width, int height)
 {
-    if (game_end)
+    if (!arena_init(&arena, width, height, snake_n, player_n, rand_get_seed()))
+    {
+        printf("Can't fit %i snakes in a %ix%i arena\n", snake_n, width, height);
+        return 1;
+    }
+
+    // Start drawing
+    render_start(false);
+
+    screen_w = get_width();
+    screen_h = get_height();
+    should_update = true;
+
+    struct jitter jitter = { 0, 0, 0, 0 };
+    double tick_ms = 0;
+    double max_tick_ms = 0;
+    double next_tick = render_now();
+    double last_frame = next_tick - FRAME_MS;
+    while (should_update)
     {
-        if (game_end_update > 4)
+        double start = trace_begin();
+        int key;
+        while ((key = render_key(0)) != ERR)
+        {
+            handle_arena_key(key, player_n);
+        }
+
+        double now = render_now();
+        for (int ran = 0; now >= next_tick && ran < (replay_on ? 1 : MAX_CATCH_UP) && should_update; ran++)
+        {
+            double late = now - next_tick;
+            jitter.ticks++;
+            jitter.total_ms += late;
+            jitter.max_ms = late > jitter.max_ms ? late : jitter.max_ms;
+            double before = now_ms();
+            arena_tick(&arena);
+            record_tick();
+            double took = now_ms() - before;
+            tick_ms += took;
+            max_tick_ms = took > max_tick_ms ? took : max_tick_ms;
+            next_tick += TICK_MS;
+        }
+        while (now >= next_tick)
+        {
+            jitter.dropped++;
+            next_tick += TICK_MS;
+        }
+        trace_end("update", start);
+
+        double wake = next_tick;
+        if (now - last_frame >= FRAME_MS)
         {
-            timeout(-1);
-            should_update = false;
+            start = trace_begin();
+            print_arena(player_n);
+            trace_end("render", start);
+            render_present();
+            last_frame = now;
         }
-        game_end_update++;
-        char *msg_game_over = "Game over!";
-        char *msg_exit = "Press any key to exit...";
-        char *msg_score = "Score: ";
-        int score_len = strlen(msg_score) + 3;
-        char msg_score_n[score_len];
-        snprintf(msg_score_n, score_len, "%s%i", msg_score, score);
-        mvprintw(MAX_HEIGHT / 2 - 1, MAX_WIDTH / 2 - (strlen(msg_game_over) - 1) / 2, "%s", msg_game_over);
-        mvprintw(MAX_HEIGHT / 2, MAX_WIDTH / 2 - (strlen(msg_score_n) - 1) / 2, "%s", msg_score_n);
-        mvprintw(MAX_HEIGHT / 2 + 1, MAX_WIDTH / 2 - (strlen(msg_exit) - 1) / 2, "%s", msg_exit);
-        getch();
+        else
+        {
+            wake = last_frame + FRAME_MS < wake ? last_frame + FRAME_MS : wake;
+        }
+        // Sleep until the next tick or frame is due, or until a key is pressed
+        double wait_ms = wake - render_now();
+        if (!render_wait(wait_ms > 0 ? wait_ms : 0))
+        {
+            break;
+        }
+    }
+
+    render_stop();
+    for (int i = 0; i < player_n; i++)
+    {
+        printf("Player %i score: %i\n", i + 1, arena.snakes[i].score);
+    }
+    if (jitter.ticks > 0)
+    {
+        printf("Tick time: %.3f ms average, %.3f ms max over %lli ticks of %i snakes\n",
+               tick_ms / jitter.ticks, max_tick_ms, jitter.ticks, snake_n);
+        printf("Tick jitter: %.3f ms average, %.3f ms max, %lli dropped\n",
+               jitter.total_ms / jitter.ticks, jitter.max_ms, jitter.dropped);
+    }
+    printf("State hash: %016llx\n", (unsigned long long) arena_hash(&arena));
+    printf("Seed: %llu\n", (unsigned long long) rand_get_seed());
+    arena_free(&arena);
+    return 0;
+}
+
+// Run the arena with bots only as fast as possible. The state hash of every tick is folded into one, so two runs
+// with the same seed print the same hash unless they went differently at any point
+static int run_arena_headless(long long ticks, int snake_n, int width, int height)
+{
+    if (!arena_init(&arena, width, height, snake_n, 0, rand_get_seed()))
+    {
+        printf("Can't fit %i snakes in a %ix%i arena\n", snake_n, width, height);
+        return 1;
+    }
+    uint64_t hash = 0;
+    double max_tick_ms = 0;
+    double start = now_ms();
+    for (long long t = 0; t < ticks; t++)
+    {
+        double before = now_ms();
+        arena_tick(&arena);
+        double took = now_ms() - before;
+        max_tick_ms = took > max_tick_ms ? took : max_tick_ms;
+        hash = rng_mix(hash, arena_hash(&arena));
+    }
+    double elapsed = now_ms() - start;
+
+    printf("%lli ticks of %i snakes in a %ix%i arena in %.3fs\n", ticks, snake_n, width, height, elapsed / 1000);
+    printf("Tick time: %.3f ms average, %.3f ms max\n", elapsed / ticks, max_tick_ms);
+    printf("Snakes alive: %i\n", arena.alive_n);
+    printf("State hash: %016llx\n", (unsigned long long) hash);
+    printf("Seed: %llu\n", (unsigned long long) rand_get_seed());
+    arena_free(&arena);
+    return 0;
+}
+
+// Advance the simulation by one step, the snake moves every few steps. Returns true if it moved
+static bool tick(int *move_ticks)
+{
+    if (++*move_ticks < (game.dir_y != 0 ? MOVE_TICKS_Y : MOVE_TICKS_X))
+    {
+        return false;
+    }
+    *move_ticks = 0;
+    return game_move(&game);
+}
+
+// Keep going straight most of the time, turning to a random free side when the way ahead is blocked
+static void wander(struct snake_game *g)
+{
+    struct segment head = body_head(&g->body);
+    bool blocked = field_is_occupied(&g->field, head.x + g->dir_x, head.y + g->dir_y);
+    if (!blocked && rand_range(0, 7) != 0)
+    {
         return;
     }
+    int side = rand_range(0, 1) * 2 - 1;
+    for (int i = 0; i < 2; i++, side = -side)
+    {
+        int x = g->dir_y * side;
+        int y = g->dir_x * side;
+        if (!field_is_occupied(&g->field, head.x + x, head.y + y))
+        {
+            game_turn(g, x, y);
+            return;
+        }
+    }
+}
 
-    // Get user input
-    input = getch();
-    switch (input)
+static void handle_key(int key)
+{
+    switch (key)
     {
         case 'w':
-        set_direction(0, -1);
-        break;
-
         case KEY_UP:
-        set_direction(0, -1);
+        game_turn(&game, 0, -1);
         break;
 
         case 'a':
-        set_direction(-1, 0);
-        break;
-
         case KEY_LEFT:
-        set_direction(-1, 0);
+        game_turn(&game, -1, 0);
         break;
 
         case 's':
-        set_direction(0, 1);
+        case KEY_DOWN:
+        game_turn(&game, 0, 1);
         break;
 
-        case KEY_DOWN:
-        set_direction(0, 1);
+        case 'd':
+        case KEY_RIGHT:
+        game_turn(&game, 1, 0);
+        break;
+
+        case '0':
+        should_update = false;
+        break;
+
+        // The terminal sends SIGWINCH when it's resized, which curses turns into this key
+        case KEY_RESIZE:
+        screen_w = get_width();
+        screen_h = get_height();
+        should_print_all = true;
+        break;
+    }
+}
+
+// With one player both sets of keys steer, with two the first player has WASD and the second the arrow keys
+static void handle_arena_key(int key, int player_n)
+{
+    int second = player_n > 1 ? 1 : 0;
+    switch (key)
+    {
+        case 'w':
+        arena_turn(&arena, 0, 0, -1);
+        break;
+
+        case 'a':
+        arena_turn(&arena, 0, -1, 0);
+        break;
+
+        case 's':
+        arena_turn(&arena, 0, 0, 1);
         break;
 
         case 'd':
-        set_direction(1, 0);
+        arena_turn(&arena, 0, 1, 0);
+        break;
+
+        case KEY_UP:
+        arena_turn(&arena, second, 0, -1);
+        break;
+
+        case KEY_LEFT:
+        arena_turn(&arena, second, -1, 0);
+        break;
+
+        case KEY_DOWN:
+        arena_turn(&arena, second, 0, 1);
         break;
 
         case KEY_RIGHT:
-        set_direction(1, 0);
+        arena_turn(&arena, second, 1, 0);
         break;
 
         case '0':
-        game_end = true;
+        should_update = false;
         break;
-    }
 
-    // Move the snake
-    if (should_grow && snake_length < MAX_LENGTH)
-    {
-        snake_x[snake_length] = snake_x[snake_length - 1] + snake_dir_x ;
-        snake_y[snake_length] = snake_y[snake_length - 1] + snake_dir_y;
-        snake_length++;
-        score++;
-        should_grow = false;
+        case KEY_RESIZE:
+        screen_w = get_width();
+        screen_h = get_height();
+        render_erase();
+        break;
     }
-    else
+}
+
+// Draw the cells that changed since the last frame, or everything after the terminal was resized
+void print_level()
+{
+    if (should_print_all || game.changed_all)
     {
-        for (int i = 0; i < snake_length; i++)
+        render_erase();
+        for (int y = 0; y < game.field.height && y < screen_h; y++)
         {
-            if (i == snake_length - 1)
+            for (int x = 0; x < game.field.width && x < screen_w; x++)
             {
-                snake_x[i] += snake_dir_x;
-                snake_y[i] += snake_dir_y;
-            }
-            else
-            {
-                snake_x[i] = snake_x[i + 1];
-                snake_y[i] = snake_y[i + 1];
+                print_cell(x, y);
             }
         }
+        should_print_all = false;
     }
-
-    // Spawn food
-    if (should_spawn_food)
+    else
     {
-        bool good_spawn;
-        do
+        for (int i = 0; i < game.changed_n; i++)
         {
-            good_spawn = spawn_food();
-        } while (!good_spawn);
-        should_spawn_food = false;
+            print_cell(game.changed[i].x, game.changed[i].y);
+        }
     }
+    game_clear_changes(&game);
+    render_move(screen_h - 1, screen_w - 1);
+}
 
-
-    // Check for collision
-    if (snake_x[snake_length - 1] < 1 || snake_x[snake_length - 1] >= MAX_WIDTH - 1)
-    {
-        game_end = true;
-    }
-    if (snake_y[snake_length - 1] < 1 || snake_y[snake_length - 1] >= MAX_HEIGHT - 1)
+// Draw one cell of the field as it is now, cells that don't fit on the screen are skipped
+static void print_cell(int x, int y)
+{
+    if (x < 0 || y < 0 || x >= screen_w || y >= screen_h)
     {
-        game_end = true;
+        return;
     }
+    static const char TILE_CHARS[] = { ' ', CH_WALL, CH_SNAKE, CH_FOOD };
+    render_add_at(y, x, TILE_CHARS[game_tile(&game, x, y)]);
+}
 
-    // Eat food
-    if (snake_x[snake_length - 1] == food_x && snake_y[snake_length - 1] == food_y)
+// Wait a moment so a key pressed just before the end isn't taken as the answer, then wait for any key. The keys
+// that come in the meantime are dropped as they come, and the wait is traced by render_wait()
+static void print_game_over()
+{
+    render_present();
+    double until = render_now() + GAME_OVER_MS;
+    while (render_now() < until && render_wait(until - render_now()))
     {
-        should_grow = true;
-        should_spawn_food = true;
+        render_flush();
     }
+    render_flush();
+    char *msg_game_over = "Game over!";
+    char *msg_exit = "Press any key to exit...";
+    char msg_score[32];
+    snprintf(msg_score, sizeof(msg_score), "Score: %i", game.score);
+    render_print_at(screen_h / 2 - 1, screen_w / 2 - (strlen(msg_game_over) - 1) / 2, "%s", msg_game_over);
+    render_print_at(screen_h / 2, screen_w / 2 - (strlen(msg_score) - 1) / 2, "%s", msg_score);
+    render_print_at(screen_h / 2 + 1, screen_w / 2 - (strlen(msg_exit) - 1) / 2, "%s", msg_exit);
+    render_present();
+    render_key(-1);
+}
 
-    // Collision with self
-    for (int i = 0; i < snake_length - 1; i++)
+// Split the screen into a view for each player, with a line between them
+static void print_arena(int player_n)
+{
+    int width = (screen_w - (player_n - 1)) / player_n;
+    for (int i = 0; i < player_n; i++)
     {
-        if (snake_x[i] == snake_x[snake_length - 1] &&
-            snake_y[i] == snake_y[snake_length - 1] && snake_length > 1)
+        int left = i * (width + 1);
+        print_view(i, left, width);
+        for (int y = 0; i > 0 && y < screen_h; y++)
         {
-            game_end = true;
+            render_add_at(y, left - 1, '|');
         }
     }
+    render_move(screen_h - 1, screen_w - 1);
 }
 
-void print_level()
+// Draw the part of the arena around a player's snake, with their score on the last row. The view stays where it
+// was while the snake waits to come back, and stops at the walls instead of showing what's outside
+static void print_view(int player, int left, int width)
 {
-    const int HEIGHT = MAX_HEIGHT;
-    const int WIDTH = MAX_WIDTH;
-    for (int y = 0; y < HEIGHT; y++)
+    const struct arena_snake *s = &arena.snakes[player];
+    int height = screen_h - 1;
+    if (s->alive)
+    {
+        struct segment head = body_head(&s->body);
+        view_x[player] = head.x - width / 2;
+        view_y[player] = head.y - height / 2;
+    }
+    int x0 = arena.field.width > width ? view_x[player] : (arena.field.width - width) / 2;
+    int y0 = arena.field.height > height ? view_y[player] : (arena.field.height - height) / 2;
+    if (arena.field.width > width)
+    {
+        x0 = x0 < 0 ? 0 : x0 > arena.field.width - width ? arena.field.width - width : x0;
+    }
+    if (arena.field.height > height)
     {
-        for (int x = 0; x < WIDTH; x++)
+        y0 = y0 < 0 ? 0 : y0 > arena.field.height - height ? arena.field.height - height : y0;
+    }
+
+    for (int row = 0; row < height; row++)
+    {
+        render_move(row, left);
+        for (int col = 0; col < width; col++)
         {
-            // Print walls
-            if (y == 0 || y == HEIGHT - 1)
+            int x = x0 + col;
+            int y = y0 + row;
+            char ch = ' ';
+            if (x >= 0 && y >= 0 && x < arena.field.width && y < arena.field.height)
             {
-                mvaddch(y, x, CH_WALL);
-            }
-            else if (x == 0 || x == WIDTH - 1)
-            {
-                mvaddch(y, x, CH_WALL);
+                int owner = arena.owner[y * arena.field.width + x];
+                if (owner >= 0)
+                {
+                    ch = owner == player ? CH_SNAKE : CH_OTHER;
+                }
+                else if (field_is_occupied(&arena.field, x, y))
+                {
+                    ch = CH_WALL;
+                }
+                else if (arena_has_food(&arena, x, y))
+                {
+                    ch = CH_FOOD;
+                }
             }
+            render_add(ch);
         }
     }
 
-    // Print snake
-    for (int i = 0; i < snake_length; i++)
+    char status[64];
+    if (s->alive)
     {
-        mvaddch(snake_y[i], snake_x[i], CH_SNAKE);
+        snprintf(status, sizeof(status), "P%i  Score: %i  Length: %i  Snakes: %i", player + 1, s->score,
+                 s->body.length, arena.alive_n);
     }
-
-    // Print food
-    mvaddch(food_y, food_x, CH_FOOD);
-    move(MAX_HEIGHT - 1, MAX_WIDTH - 1);
-}
-
-void set_direction(int x, int y)
-{
-    if (snake_dir_y == -y || snake_dir_x == -x)
+    else
     {
-        return;
+        snprintf(status, sizeof(status), "P%i  Back in %.1fs", player + 1, s->respawn_ticks * TICK_MS / 1000);
     }
-    snake_dir_y = y;
-    snake_dir_x = x;
-    if (y != 0) { timeout(SPEED * 1.75); }
-    else { timeout(SPEED); }
+    render_print_at(height, left, "%-*.*s", width, width, status);
 }
 
-bool spawn_food()
-{
-    food_x = rand_range(1, MAX_WIDTH - 2);
-    food_y = rand_range(1, MAX_HEIGHT - 2);
-    for (int i = 0; i < snake_length; i++)
-    {
-        if (snake_x[i] == food_x && snake_y[i] == food_y)
-        {
-            return false;
-        }
-    }
-    return true;
-}
@@ -1 +1 @@
-void snake();
+int snake(int argc, char *argv[]);
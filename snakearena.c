@@ -0,0 +1,371 @@
+#include "snakearena.h"
+
+#include <stdlib.h>
+
+#define MOVE_TICKS_X 4    // Same speeds as a single game
+#define MOVE_TICKS_Y 7
+#define START_LENGTH 4    // A new snake starts as one segment and grows this long over its first moves
+#define RESPAWN_TICKS 120 // A dead snake comes back after about 2 seconds
+#define FOOD_PER_SNAKE 2
+#define FOOD_SAMPLES 4    // Food a bot looks at when picking the closest one
+#define SPAWN_TRIES 8     // Random cells tried before giving up for a tick
+
+static void spawn(struct arena *a, int i);
+static void kill(struct arena *a, int i);
+static void steer(struct arena *a, int i);
+static void pick_target(struct arena *a, int i);
+static int random_empty(struct arena *a);
+static void occupy(struct arena *a, int cell, int snake);
+static void release(struct arena *a, int cell);
+static void add_food(struct arena *a, int cell);
+static void remove_food(struct arena *a, int cell);
+static uint64_t cell_key(int cell, int owner);
+
+static const int DIRECTIONS[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+
+// Set up an arena with walls around it and every snake placed at random, the first player_n snakes are players
+bool arena_init(struct arena *a, int width, int height, int snake_n, int player_n, uint64_t seed)
+{
+    if (width < 3 || height < 3 || snake_n < 1 || player_n < 0 || player_n > snake_n
+        || (long long) snake_n * (1 + FOOD_PER_SNAKE) > (long long) (width - 2) * (height - 2)
+        || !field_init(&a->field, width, height))
+    {
+        return false;
+    }
+    int size = width * height;
+    a->owner = malloc((size_t) size * sizeof(int));
+    a->food_cells = malloc((size_t) size * sizeof(int));
+    a->food_index = malloc((size_t) size * sizeof(int));
+    a->claim = malloc((size_t) size * sizeof(int));
+    a->claim_tick = calloc((size_t) size, sizeof(long long));
+    a->snakes = calloc((size_t) snake_n, sizeof(struct arena_snake));
+    if (a->owner == NULL || a->food_cells == NULL || a->food_index == NULL || a->claim == NULL
+        || a->claim_tick == NULL || a->snakes == NULL)
+    {
+        a->snake_n = 0;
+        arena_free(a);
+        return false;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        a->owner[i] = -1;
+        a->food_index[i] = -1;
+    }
+    for (int x = 0; x < width; x++)
+    {
+        field_occupy(&a->field, x, 0);
+        field_occupy(&a->field, x, height - 1);
+    }
+    for (int y = 0; y < height; y++)
+    {
+        field_occupy(&a->field, 0, y);
+        field_occupy(&a->field, width - 1, y);
+    }
+    a->food_n = 0;
+    a->food_target = snake_n * FOOD_PER_SNAKE;
+    a->snake_n = snake_n;
+    a->alive_n = 0;
+    a->tick = 0;
+    a->hash = 0;
+    rng_seed(&a->rng, seed);
+
+    for (int i = 0; i < snake_n; i++)
+    {
+        struct arena_snake *s = &a->snakes[i];
+        s->body.segments = NULL;
+        if (!body_init(&s->body, 0, 0))
+        {
+            arena_free(a);
+            return false;
+        }
+        body_pop(&s->body);
+        s->player = i < player_n;
+        s->alive = false;
+        spawn(a, i);
+    }
+    return true;
+}
+
+void arena_free(struct arena *a)
+{
+    for (int i = 0; a->snakes != NULL && i < a->snake_n; i++)
+    {
+        body_free(&a->snakes[i].body);
+    }
+    free(a->owner);
+    free(a->food_cells);
+    free(a->food_index);
+    free(a->claim);
+    free(a->claim_tick);
+    free(a->snakes);
+    field_free(&a->field);
+    a->owner = NULL;
+    a->food_cells = NULL;
+    a->food_index = NULL;
+    a->claim = NULL;
+    a->claim_tick = NULL;
+    a->snakes = NULL;
+}
+
+// Head in a new direction from the snake's next move on, turning back into it is ignored
+void arena_turn(struct arena *a, int snake, int x, int y)
+{
+    struct arena_snake *s = &a->snakes[snake];
+    if ((x != 0 && x == -s->moved_x) || (y != 0 && y == -s->moved_y))
+    {
+        return;
+    }
+    s->dir_x = x;
+    s->dir_y = y;
+}
+
+// Move every snake that is due, all at once: the tails leave their cells first, then a head dies if its cell is
+// taken or if another head moves there too. Dead snakes leave food behind and come back later
+void arena_tick(struct arena *a)
+{
+    a->tick++;
+    int width = a->field.width;
+    for (int i = 0; i < a->snake_n; i++)
+    {
+        struct arena_snake *s = &a->snakes[i];
+        s->next = -1;
+        if (!s->alive || ++s->move_ticks < (s->dir_y != 0 ? MOVE_TICKS_Y : MOVE_TICKS_X))
+        {
+            continue;
+        }
+        s->move_ticks = 0;
+        if (!s->player)
+        {
+            steer(a, i);
+        }
+        struct segment head = body_head(&s->body);
+        s->next = (head.y + s->dir_y) * width + head.x + s->dir_x;
+
+        // A second head moving to the same cell clears the claim, so every head moving there dies
+        if (a->claim_tick[s->next] == a->tick)
+        {
+            a->claim[s->next] = -1;
+        }
+        else
+        {
+            a->claim_tick[s->next] = a->tick;
+            a->claim[s->next] = i;
+        }
+    }
+
+    for (int i = 0; i < a->snake_n; i++)
+    {
+        struct arena_snake *s = &a->snakes[i];
+        if (s->next < 0)
+        {
+            continue;
+        }
+        if (s->grow > 0)
+        {
+            s->grow--;
+            continue;
+        }
+        struct segment tail = body_at(&s->body, 0);
+        release(a, tail.y * width + tail.x);
+        body_pop(&s->body);
+    }
+
+    // Heads only move to cells no other head claimed, so a head that moves in can't block another one this tick
+    for (int i = 0; i < a->snake_n; i++)
+    {
+        struct arena_snake *s = &a->snakes[i];
+        if (s->next < 0)
+        {
+            continue;
+        }
+        if (a->claim[s->next] != i || field_is_occupied(&a->field, s->next % width, s->next / width)
+            || !body_push(&s->body, s->next % width, s->next / width))
+        {
+            s->alive = false;
+            continue;
+        }
+        occupy(a, s->next, i);
+        s->moved_x = s->dir_x;
+        s->moved_y = s->dir_y;
+        if (a->food_index[s->next] >= 0)
+        {
+            remove_food(a, s->next);
+            s->grow++;
+            s->score++;
+        }
+    }
+
+    // The dead are only taken away once every head has moved, so their bodies blocked the others until now
+    for (int i = 0; i < a->snake_n; i++)
+    {
+        if (a->snakes[i].next >= 0 && !a->snakes[i].alive)
+        {
+            kill(a, i);
+        }
+        else if (!a->snakes[i].alive && --a->snakes[i].respawn_ticks <= 0)
+        {
+            spawn(a, i);
+        }
+    }
+
+    for (int missing = a->food_target - a->food_n; missing > 0; missing--)
+    {
+        int cell = random_empty(a);
+        if (cell < 0)
+        {
+            break;
+        }
+        add_food(a, cell);
+    }
+}
+
+// Bring a snake back on a random empty cell, heading in a random direction. It stays dead if none is found
+static void spawn(struct arena *a, int i)
+{
+    struct arena_snake *s = &a->snakes[i];
+    int cell = random_empty(a);
+    if (cell < 0)
+    {
+        s->respawn_ticks = 1;
+        return;
+    }
+    body_push(&s->body, cell % a->field.width, cell / a->field.width);
+    occupy(a, cell, i);
+    int d = rng_range(&a->rng, 0, 3);
+    s->dir_x = DIRECTIONS[d][0];
+    s->dir_y = DIRECTIONS[d][1];
+    s->moved_x = 0;
+    s->moved_y = 0;
+    s->move_ticks = 0;
+    s->grow = START_LENGTH - 1;
+    s->respawn_ticks = 0;
+    s->alive = true;
+    s->score = 0;
+    s->target = -1;
+    a->alive_n++;
+}
+
+// Take a dead snake off the field, leaving food on every other cell it took up
+static void kill(struct arena *a, int i)
+{
+    struct arena_snake *s = &a->snakes[i];
+    for (int n = 0; s->body.length > 0; n++)
+    {
+        struct segment tail = body_at(&s->body, 0);
+        int cell = tail.y * a->field.width + tail.x;
+        release(a, cell);
+        body_pop(&s->body);
+        if (n % 2 != 0)
+        {
+            add_food(a, cell);
+        }
+    }
+    s->respawn_ticks = RESPAWN_TICKS;
+    a->alive_n--;
+}
+
+// Keep heading for the bot's food, going straight or turning to whichever free side gets closer to it
+static void steer(struct arena *a, int i)
+{
+    struct arena_snake *s = &a->snakes[i];
+    if (s->target < 0 || a->food_index[s->target] < 0)
+    {
+        pick_target(a, i);
+    }
+    struct segment head = body_head(&s->body);
+    int target_x = s->target >= 0 ? s->target % a->field.width : head.x + s->dir_x;
+    int target_y = s->target >= 0 ? s->target / a->field.width : head.y + s->dir_y;
+    int options[3][2] = { { s->dir_x, s->dir_y }, { -s->dir_y, s->dir_x }, { s->dir_y, -s->dir_x } };
+    int best = -1;
+    int best_dist = 0;
+    for (int o = 0; o < 3; o++)
+    {
+        int x = head.x + options[o][0];
+        int y = head.y + options[o][1];
+        if (field_is_occupied(&a->field, x, y))
+        {
+            continue;
+        }
+        int dist = abs(target_x - x) + abs(target_y - y);
+        if (best < 0 || dist < best_dist)
+        {
+            best = o;
+            best_dist = dist;
+        }
+    }
+    if (best >= 0)
+    {
+        arena_turn(a, i, options[best][0], options[best][1]);
+    }
+}
+
+// Pick the closest of a few random pieces of food, so the bots spread out over the food without searching for it
+static void pick_target(struct arena *a, int i)
+{
+    struct arena_snake *s = &a->snakes[i];
+    struct segment head = body_head(&s->body);
+    s->target = -1;
+    int best_dist = 0;
+    for (int n = 0; n < FOOD_SAMPLES && a->food_n > 0; n++)
+    {
+        int cell = a->food_cells[rng_range(&a->rng, 0, a->food_n - 1)];
+        int dist = abs(cell % a->field.width - head.x) + abs(cell / a->field.width - head.y);
+        if (s->target < 0 || dist < best_dist)
+        {
+            s->target = cell;
+            best_dist = dist;
+        }
+    }
+}
+
+// Returns a random free cell without food, or -1 if none was found in a few tries
+static int random_empty(struct arena *a)
+{
+    for (int n = 0; n < SPAWN_TRIES && a->field.free_n > 0; n++)
+    {
+        int cell = a->field.free_cells[rng_range(&a->rng, 0, a->field.free_n - 1)];
+        if (a->food_index[cell] < 0)
+        {
+            return cell;
+        }
+    }
+    return -1;
+}
+
+static void occupy(struct arena *a, int cell, int snake)
+{
+    field_occupy(&a->field, cell % a->field.width, cell / a->field.width);
+    a->owner[cell] = snake;
+    a->hash ^= cell_key(cell, snake);
+}
+
+static void release(struct arena *a, int cell)
+{
+    a->hash ^= cell_key(cell, a->owner[cell]);
+    a->owner[cell] = -1;
+    field_release(&a->field, cell % a->field.width, cell / a->field.width);
+}
+
+static void add_food(struct arena *a, int cell)
+{
+    a->food_index[cell] = a->food_n;
+    a->food_cells[a->food_n++] = cell;
+    a->hash ^= cell_key(cell, -1);
+}
+
+// Take food off a cell, moving the last piece into its place
+static void remove_food(struct arena *a, int cell)
+{
+    int index = a->food_index[cell];
+    int last = a->food_cells[--a->food_n];
+    a->food_cells[index] = last;
+    a->food_index[last] = index;
+    a->food_index[cell] = -1;
+    a->hash ^= cell_key(cell, -1);
+}
+
+// Random looking bits for a cell and what's on it, the hash is the XOR of the keys of everything on the field
+static uint64_t cell_key(int cell, int owner)
+{
+    return rng_mix((uint64_t) cell, (uint64_t) (owner + 1));
+}
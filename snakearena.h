@@ -0,0 +1,66 @@
+#ifndef SNAKEARENA_H
+#define SNAKEARENA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "snakebody.h"
+#include "snakefield.h"
+#include "utils.h"
+
+// One snake of the arena, steered by a player or by the computer
+struct arena_snake
+{
+    struct body body;
+    int dir_x;
+    int dir_y;
+    int moved_x;
+    int moved_y;
+    int move_ticks;    // Ticks since the last move
+    int grow;          // Segments still to be added
+    int respawn_ticks; // Ticks until a dead snake comes back
+    bool alive;
+    bool player;
+    int score;
+    int target;        // Food cell a bot is heading for, -1 if it has to pick one
+    int next;          // Cell the head moves to this tick, -1 if the snake doesn't move
+};
+
+// Many snakes sharing one large field surrounded by walls. The field's bitmap is the spatial grid every collision
+// goes through, the owner of each cell says which snake is there. Each tick moves every snake at once, so the
+// result doesn't depend on the order the snakes are stored in, and the arena has its own generator so the same
+// seed and the same keys always play out the same way
+struct arena
+{
+    struct field field;
+    int *owner;        // Snake at each cell, -1 for walls and free cells
+    int *food_cells;   // Cells with food, as a set like the field's free cells
+    int *food_index;   // Position of each cell in food_cells, -1 if there's no food on it
+    int food_n;
+    int food_target;   // Food is topped up to this amount every tick
+    int *claim;        // Snake whose head moves to each cell, valid if claim_tick matches the tick
+    long long *claim_tick;
+    struct arena_snake *snakes;
+    int snake_n;
+    int alive_n;
+    struct rng rng;
+    long long tick;
+    uint64_t hash;     // Hash of every snake cell and its owner and of every food cell, kept up to date as they change
+};
+
+bool arena_init(struct arena *a, int width, int height, int snake_n, int player_n, uint64_t seed);
+void arena_free(struct arena *a);
+void arena_turn(struct arena *a, int snake, int x, int y);
+void arena_tick(struct arena *a);
+
+// Hash of the whole state after the current tick, two runs that hash the same at every tick played the same
+static inline uint64_t arena_hash(const struct arena *a)
+{
+    return rng_mix(a->hash, (uint64_t) a->tick);
+}
+
+static inline bool arena_has_food(const struct arena *a, int x, int y)
+{
+    return a->food_index[y * a->field.width + x] >= 0;
+}
+
+#endif
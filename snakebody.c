@@ -0,0 +1,62 @@
+#include "snakebody.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define START_CAPACITY 64
+
+// Start a snake of one segment
+bool body_init(struct body *b, int x, int y)
+{
+    b->segments = malloc(START_CAPACITY * sizeof(struct segment));
+    if (b->segments == NULL)
+    {
+        return false;
+    }
+    b->capacity = START_CAPACITY;
+    b->tail = 0;
+    b->length = 0;
+    return body_push(b, x, y);
+}
+
+void body_free(struct body *b)
+{
+    free(b->segments);
+    b->segments = NULL;
+}
+
+// Add a new head, doubling the buffer if it's full. Returns false if there's no memory for it
+bool body_push(struct body *b, int x, int y)
+{
+    if (b->length == b->capacity)
+    {
+        if (b->capacity > INT_MAX / 2)
+        {
+            return false;
+        }
+        struct segment *resized = realloc(b->segments, (size_t) b->capacity * 2 * sizeof(struct segment));
+        if (resized == NULL)
+        {
+            return false;
+        }
+
+        // Move the segments that wrapped around to the start so they follow the rest again
+        memcpy(&resized[b->capacity], resized, (size_t) b->tail * sizeof(struct segment));
+        b->segments = resized;
+        b->capacity *= 2;
+    }
+    b->segments[(b->tail + b->length) & (b->capacity - 1)] = (struct segment) { x, y };
+    b->length++;
+    return true;
+}
+
+// Remove the tail
+void body_pop(struct body *b)
+{
+    if (b->length > 0)
+    {
+        b->tail = (b->tail + 1) & (b->capacity - 1);
+        b->length--;
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef SNAKEBODY_H
+#define SNAKEBODY_H
+
+#include <stdbool.h>
+
+struct segment
+{
+    int x;
+    int y;
+};
+
+// The snake's segments in a ring buffer that doubles when it's full, so moving only adds a head and removes a tail
+struct body
+{
+    struct segment *segments;
+    int capacity; // Always a power of 2
+    int tail;     // Index of the last segment
+    int length;
+};
+
+bool body_init(struct body *b, int x, int y);
+void body_free(struct body *b);
+bool body_push(struct body *b, int x, int y);
+void body_pop(struct body *b);
+
+// Segment i counted from the tail, 0 is the tail and length - 1 is the head
+static inline struct segment body_at(const struct body *b, int i)
+{
+    return b->segments[(b->tail + i) & (b->capacity - 1)];
+}
+
+static inline struct segment body_head(const struct body *b)
+{
+    return body_at(b, b->length - 1);
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include "snakefield.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include "utils.h"
+
+// Allocate a field with every cell free
+bool field_init(struct field *f, int width, int height)
+{
+    if (width < 1 || height < 1 || (long long) width * height > INT_MAX)
+    {
+        return false;
+    }
+    int size = width * height;
+    f->width = width;
+    f->height = height;
+    f->occupied = calloc((size_t) size / 64 + 1, sizeof(uint64_t));
+    f->free_cells = malloc((size_t) size * sizeof(int));
+    f->free_index = malloc((size_t) size * sizeof(int));
+    if (f->occupied == NULL || f->free_cells == NULL || f->free_index == NULL)
+    {
+        field_free(f);
+        return false;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        f->free_cells[i] = i;
+        f->free_index[i] = i;
+    }
+    f->free_n = size;
+    return true;
+}
+
+void field_free(struct field *f)
+{
+    free(f->occupied);
+    free(f->free_cells);
+    free(f->free_index);
+    f->occupied = NULL;
+    f->free_cells = NULL;
+    f->free_index = NULL;
+}
+
+// Mark a cell as taken, moving the last free cell into its place in the set
+void field_occupy(struct field *f, int x, int y)
+{
+    int i = y * f->width + x;
+    int index = f->free_index[i];
+    if (index < 0)
+    {
+        return;
+    }
+    int last = f->free_cells[--f->free_n];
+    f->free_cells[index] = last;
+    f->free_index[last] = index;
+    f->free_index[i] = -1;
+    f->occupied[i / 64] |= 1ULL << (i % 64);
+}
+
+// Mark a cell as free again, adding it to the end of the set
+void field_release(struct field *f, int x, int y)
+{
+    int i = y * f->width + x;
+    if (f->free_index[i] >= 0)
+    {
+        return;
+    }
+    f->free_cells[f->free_n] = i;
+    f->free_index[i] = f->free_n++;
+    f->occupied[i / 64] &= ~(1ULL << (i % 64));
+}
+
+// Returns a free cell picked uniformly at random, or -1 if the field is full
+int field_random_free(const struct field *f)
+{
+    return f->free_n > 0 ? f->free_cells[rand_range(0, f->free_n - 1)] : -1;
+}
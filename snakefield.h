@@ -0,0 +1,36 @@
+#ifndef SNAKEFIELD_H
+#define SNAKEFIELD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Which cells of the playing field are taken by walls or the snake, as a bitmap for collisions,
+// and the free cells as a set that can be added to, removed from and picked from at random in constant time
+struct field
+{
+    int width;
+    int height;
+    uint64_t *occupied;
+    int *free_cells;
+    int *free_index; // Position of each cell in free_cells, -1 if it's occupied
+    int free_n;
+};
+
+bool field_init(struct field *f, int width, int height);
+void field_free(struct field *f);
+void field_occupy(struct field *f, int x, int y);
+void field_release(struct field *f, int x, int y);
+int field_random_free(const struct field *f);
+
+// Cells outside the field count as occupied
+static inline bool field_is_occupied(const struct field *f, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= f->width || y >= f->height)
+    {
+        return true;
+    }
+    int i = y * f->width + x;
+    return f->occupied[i / 64] >> (i % 64) & 1;
+}
+
+#endif
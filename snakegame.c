@@ -0,0 +1,128 @@
+#include "snakegame.h"
+
+#include "utils.h"
+
+static void spawn_food(struct snake_game *g);
+static void mark_changed(struct snake_game *g, int x, int y);
+
+// Start a game with walls around the edge of the field and the snake in the middle, heading in a random direction
+bool game_init(struct snake_game *g, int width, int height)
+{
+    if (width < 3 || height < 3 || !field_init(&g->field, width, height))
+    {
+        return false;
+    }
+    for (int x = 0; x < width; x++)
+    {
+        field_occupy(&g->field, x, 0);
+        field_occupy(&g->field, x, height - 1);
+    }
+    for (int y = 0; y < height; y++)
+    {
+        field_occupy(&g->field, 0, y);
+        field_occupy(&g->field, width - 1, y);
+    }
+    if (!body_init(&g->body, width / 2, height / 2))
+    {
+        field_free(&g->field);
+        return false;
+    }
+    field_occupy(&g->field, width / 2, height / 2);
+
+    g->dir_x = rand_range(-1, 1);
+    g->dir_y = 0;
+    while (g->dir_x == 0 && g->dir_y == 0)
+    {
+        g->dir_y = rand_range(-1, 1);
+    }
+    g->moved_x = 0;
+    g->moved_y = 0;
+    g->should_grow = false;
+    g->over = false;
+    g->score = 0;
+    game_clear_changes(g);
+    spawn_food(g);
+    return true;
+}
+
+void game_free(struct snake_game *g)
+{
+    body_free(&g->body);
+    field_free(&g->field);
+}
+
+// Head in a new direction from the next move on, turning back into the snake is ignored
+void game_turn(struct snake_game *g, int x, int y)
+{
+    if ((x != 0 && x == -g->moved_x) || (y != 0 && y == -g->moved_y))
+    {
+        return;
+    }
+    g->dir_x = x;
+    g->dir_y = y;
+}
+
+// Move the snake one cell by adding a head, the tail moves out of the way first unless the snake is growing.
+// Returns false once the game is over
+bool game_move(struct snake_game *g)
+{
+    if (g->over)
+    {
+        return false;
+    }
+    struct segment head = body_head(&g->body);
+    head.x += g->dir_x;
+    head.y += g->dir_y;
+    if (g->should_grow)
+    {
+        g->score++;
+        g->should_grow = false;
+    }
+    else
+    {
+        struct segment tail = body_at(&g->body, 0);
+        field_release(&g->field, tail.x, tail.y);
+        body_pop(&g->body);
+        mark_changed(g, tail.x, tail.y);
+    }
+
+    // Check for collision with the walls or itself
+    if (field_is_occupied(&g->field, head.x, head.y) || !body_push(&g->body, head.x, head.y))
+    {
+        g->over = true;
+        return false;
+    }
+    field_occupy(&g->field, head.x, head.y);
+    mark_changed(g, head.x, head.y);
+    g->moved_x = g->dir_x;
+    g->moved_y = g->dir_y;
+
+    // Eat food
+    if (head.x == g->food_x && head.y == g->food_y)
+    {
+        g->should_grow = true;
+        spawn_food(g);
+    }
+    return true;
+}
+
+// Place the food on a random free cell, there is none when the snake fills the whole field
+static void spawn_food(struct snake_game *g)
+{
+    int cell = field_random_free(&g->field);
+    g->food_x = cell >= 0 ? cell % g->field.width : -1;
+    g->food_y = cell >= 0 ? cell / g->field.width : -1;
+    mark_changed(g, g->food_x, g->food_y);
+}
+
+static void mark_changed(struct snake_game *g, int x, int y)
+{
+    if (g->changed_n < MAX_CHANGED)
+    {
+        g->changed[g->changed_n++] = (struct segment) { x, y };
+    }
+    else
+    {
+        g->changed_all = true;
+    }
+}
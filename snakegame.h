@@ -0,0 +1,65 @@
+#ifndef SNAKEGAME_H
+#define SNAKEGAME_H
+
+#include <stdbool.h>
+#include "snakebody.h"
+#include "snakefield.h"
+
+#define MAX_CHANGED 16 // Cells remembered between two frames, each move changes the old tail, the new head and the food
+
+// One game of Snake without any drawing: a field surrounded by walls, the snake and its food
+struct snake_game
+{
+    struct field field;
+    struct body body;
+    int dir_x;
+    int dir_y;
+    int moved_x; // Direction of the last move, the snake can't turn back on itself
+    int moved_y;
+    int food_x;  // -1 when the snake fills the field
+    int food_y;
+    bool should_grow;
+    bool over;
+    int score;
+
+    // Cells changed since the last call to game_clear_changes(), so only they have to be drawn
+    struct segment changed[MAX_CHANGED];
+    int changed_n;
+    bool changed_all; // More cells changed than fit, everything has to be drawn
+};
+
+bool game_init(struct snake_game *g, int width, int height);
+void game_free(struct snake_game *g);
+void game_turn(struct snake_game *g, int x, int y);
+bool game_move(struct snake_game *g);
+
+// What to draw at a cell
+enum tile
+{
+    TILE_EMPTY,
+    TILE_WALL,
+    TILE_SNAKE,
+    TILE_FOOD,
+};
+
+static inline enum tile game_tile(const struct snake_game *g, int x, int y)
+{
+    const struct field *f = &g->field;
+    if (x == 0 || y == 0 || x == f->width - 1 || y == f->height - 1)
+    {
+        return TILE_WALL;
+    }
+    if (field_is_occupied(f, x, y))
+    {
+        return TILE_SNAKE;
+    }
+    return x == g->food_x && y == g->food_y ? TILE_FOOD : TILE_EMPTY;
+}
+
+static inline void game_clear_changes(struct snake_game *g)
+{
+    g->changed_n = 0;
+    g->changed_all = false;
+}
+
+#endif
@@ -0,0 +1,247 @@
+#include "snakepilot.h"
+
+#include <stdlib.h>
+
+#define SEARCH_BUDGET 1024 // Cells added to the distance field per decision
+#define SHORTCUT_LENGTH 2   // Shortcuts stop once the snake fills 1/2 of the cycle
+#define SHORTCUT_ROOM 8     // and need 1/8 of it free ahead of the head
+
+static void build_cycle(struct pilot *p, int width, int height);
+static void add_cell(struct pilot *p, bool sideways, int x, int y);
+static void search(struct pilot *p, const struct snake_game *g, int budget);
+
+static const int DIRECTIONS[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+
+bool pilot_init(struct pilot *p, const struct snake_game *g)
+{
+    p->width = g->field.width;
+    p->size = g->field.width * g->field.height;
+    p->cycle = malloc((size_t) p->size * sizeof(int));
+    p->dist = malloc((size_t) p->size * sizeof(int));
+    p->stamp = calloc((size_t) p->size, sizeof(unsigned int));
+    p->queue = malloc((size_t) p->size * sizeof(int));
+    if (p->cycle == NULL || p->dist == NULL || p->stamp == NULL || p->queue == NULL)
+    {
+        pilot_free(p);
+        return false;
+    }
+    build_cycle(p, g->field.width, g->field.height);
+    p->generation = 0;
+    p->queue_head = 0;
+    p->queue_n = 0;
+    p->food = -1;
+    return true;
+}
+
+void pilot_free(struct pilot *p)
+{
+    free(p->cycle);
+    free(p->dist);
+    free(p->stamp);
+    free(p->queue);
+    p->cycle = NULL;
+    p->dist = NULL;
+    p->stamp = NULL;
+    p->queue = NULL;
+}
+
+// Pick the next direction. Along the cycle, the snake's segments always come in order from the tail to the head,
+// so every cell after the head and before the tail is free. Moving to any of those cells keeps that true, so the
+// tail can always be reached. Of those moves, the one closest to the food is taken, or the next cell on the cycle
+// when the food's distance to the head isn't known yet
+void pilot_steer(struct pilot *p, struct snake_game *g)
+{
+    int food = g->food_y >= 0 ? g->food_y * p->width + g->food_x : -1;
+    if (food != p->food)
+    {
+        p->food = food;
+        p->generation++;
+        p->queue_head = 0;
+        p->queue_n = 0;
+        if (food >= 0)
+        {
+            p->stamp[food] = p->generation;
+            p->dist[food] = 0;
+            p->queue[p->queue_n++] = food;
+        }
+    }
+    search(p, g, SEARCH_BUDGET);
+
+    // Where the tail will be after this move, the cell it leaves can be moved into
+    struct segment head = body_head(&g->body);
+    struct segment tail = body_at(&g->body, 0);
+    bool tail_moves = !g->should_grow;
+    int head_pos = p->cycle[head.y * p->width + head.x];
+    int to_tail = p->cycle_n;
+    if (head_pos >= 0 && (!tail_moves || g->body.length > 1))
+    {
+        struct segment next_tail = tail_moves ? body_at(&g->body, 1) : tail;
+        int tail_pos = p->cycle[next_tail.y * p->width + next_tail.x];
+        to_tail = tail_pos >= 0 ? (tail_pos - head_pos + p->cycle_n) % p->cycle_n : 0;
+        to_tail = to_tail == 0 ? p->cycle_n : to_tail;
+    }
+    int free_n = g->field.free_n;
+
+    // Shortcuts never skip the food on the cycle, so every move brings it closer
+    int to_food = to_tail;
+    if (head_pos >= 0 && food >= 0 && p->cycle[food] >= 0)
+    {
+        to_food = (p->cycle[food] - head_pos + p->cycle_n) % p->cycle_n;
+    }
+
+    int best = -1;
+    int fallback = -1; // Any move that doesn't hit something straight away, for when none are safe
+    int best_dist = 0;
+    int best_ahead = 0;
+    for (int d = 0; d < 4; d++)
+    {
+        int x = head.x + DIRECTIONS[d][0];
+        int y = head.y + DIRECTIONS[d][1];
+        int cell = y * p->width + x;
+        bool reverse = DIRECTIONS[d][0] == -g->moved_x && DIRECTIONS[d][1] == -g->moved_y;
+        bool leaving = tail_moves && x == tail.x && y == tail.y;
+        if (reverse || (field_is_occupied(&g->field, x, y) && !leaving))
+        {
+            continue;
+        }
+        fallback = fallback < 0 ? d : fallback;
+
+        // Without a cycle through the head, any free cell will do
+        int ahead = 1;
+        if (head_pos >= 0)
+        {
+            ahead = p->cycle[cell] >= 0 ? (p->cycle[cell] - head_pos + p->cycle_n) % p->cycle_n : 0;
+            if (ahead == 0 || ahead >= to_tail || ahead > to_food || (ahead == to_food && cell != food))
+            {
+                continue;
+            }
+
+            // Skipping cells leaves holes behind the head that can't be used until the tail passes them, so
+            // shortcuts are only taken while the snake is short and there's plenty of room left before the tail
+            int room = to_tail - ahead;
+            if (ahead > 1 && (g->body.length >= p->cycle_n / SHORTCUT_LENGTH || room < p->cycle_n / SHORTCUT_ROOM))
+            {
+                continue;
+            }
+
+            // The tail stays put for a move after eating, so there has to be a free cell left for it
+            if (cell == food && room < 2 && free_n > 1)
+            {
+                continue;
+            }
+        }
+
+        // Cells with a known distance come first, closest to the food, then cells further along the cycle
+        int dist = p->stamp[cell] == p->generation ? p->dist[cell] : -1;
+        bool better = best < 0;
+        if (!better && dist >= 0)
+        {
+            better = best_dist < 0 || dist < best_dist || (dist == best_dist && ahead > best_ahead);
+        }
+        else if (!better && best_dist < 0)
+        {
+            better = ahead > best_ahead;
+        }
+        if (better)
+        {
+            best = d;
+            best_dist = dist;
+            best_ahead = ahead;
+        }
+    }
+    best = best >= 0 ? best : fallback;
+    if (best >= 0)
+    {
+        game_turn(g, DIRECTIONS[best][0], DIRECTIONS[best][1]);
+    }
+}
+
+// A cycle through the inside of the field: along the top row, then down and up the columns back to the start.
+// That needs an even number of columns, so the field is turned sideways if only its height is even. If neither
+// is, the last two rows are covered by zigzagging between them instead, which leaves out the bottom right cell.
+// That cell shares its position with the cell diagonally from it, so the snake can go around the corner instead
+// of through that cell, and only one of them can be part of the snake
+static void build_cycle(struct pilot *p, int width, int height)
+{
+    for (int i = 0; i < p->size; i++)
+    {
+        p->cycle[i] = -1;
+    }
+    int inside_w = width - 2;
+    int inside_h = height - 2;
+    bool sideways = inside_w % 2 != 0 && inside_h % 2 == 0;
+    int w = sideways ? inside_h : inside_w;
+    int h = sideways ? inside_w : inside_h;
+    p->cycle_n = 0;
+    if (w < 2 || h < 2)
+    {
+        return;
+    }
+
+    for (int x = 0; x < w; x++)
+    {
+        add_cell(p, sideways, x, 0);
+    }
+    if (w % 2 == 0)
+    {
+        for (int x = w - 1; x >= 0; x--)
+        {
+            for (int i = 1; i < h; i++)
+            {
+                add_cell(p, sideways, x, (w - 1 - x) % 2 == 0 ? i : h - i);
+            }
+        }
+        return;
+    }
+    for (int y = 1; y < h - 2; y++)
+    {
+        for (int i = 1; i < w; i++)
+        {
+            add_cell(p, sideways, y % 2 != 0 ? w - i : i, y);
+        }
+    }
+    add_cell(p, sideways, w - 1, h - 2);
+    for (int x = w - 2; x >= 1; x--)
+    {
+        bool down = (w - 2 - x) % 2 == 0;
+        add_cell(p, sideways, x, down ? h - 2 : h - 1);
+        add_cell(p, sideways, x, down ? h - 1 : h - 2);
+    }
+    for (int y = h - 1; y >= 1; y--)
+    {
+        add_cell(p, sideways, 0, y);
+    }
+    p->cycle[h * width + w] = p->cycle[(h - 1) * width + w - 1];
+}
+
+// Put a cell of the inside of the field next on the cycle
+static void add_cell(struct pilot *p, bool sideways, int x, int y)
+{
+    int field_x = 1 + (sideways ? y : x);
+    int field_y = 1 + (sideways ? x : y);
+    p->cycle[field_y * p->width + field_x] = p->cycle_n++;
+}
+
+// Continue the breadth first search from the food through free cells, adding at most budget cells
+static void search(struct pilot *p, const struct snake_game *g, int budget)
+{
+    while (p->queue_head < p->queue_n && budget > 0)
+    {
+        int cell = p->queue[p->queue_head++];
+        int x = cell % p->width;
+        int y = cell / p->width;
+        for (int d = 0; d < 4; d++)
+        {
+            int a_x = x + DIRECTIONS[d][0];
+            int a_y = y + DIRECTIONS[d][1];
+            int next = a_y * p->width + a_x;
+            if (!field_is_occupied(&g->field, a_x, a_y) && p->stamp[next] != p->generation)
+            {
+                p->stamp[next] = p->generation;
+                p->dist[next] = p->dist[cell] + 1;
+                p->queue[p->queue_n++] = next;
+                budget--;
+            }
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef SNAKEPILOT_H
+#define SNAKEPILOT_H
+
+#include <stdbool.h>
+#include "snakegame.h"
+
+// Steers a snake towards the food without ever trapping itself. The snake follows a cycle through every cell
+// of the field, taking shortcuts towards the food only when they can't cut it off from its tail
+struct pilot
+{
+    int width;
+    int size;
+    int *cycle;       // Position of each cell on the cycle, -1 for walls and cells left out of it
+    int cycle_n;
+
+    // Distance from the food to every cell, found breadth first a few cells per decision so no decision takes
+    // long however big the field is. A distance is only valid if its stamp matches the current generation
+    int *dist;
+    unsigned int *stamp;
+    unsigned int generation;
+    int *queue;
+    int queue_head;
+    int queue_n;
+    int food; // Cell the distances are measured from
+};
+
+bool pilot_init(struct pilot *p, const struct snake_game *g);
+void pilot_free(struct pilot *p);
+void pilot_steer(struct pilot *p, struct snake_game *g);
+
+#endif
@@ -1,71 +1,158 @@
 #include "tictactoe.h"
 
-#include <ncurses.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "record.h"
+#include "render.h"
+#include "trace.h"
+#include "tttboard.h"
+#include "tttmcts.h"
+#include "tttsearch.h"
+#include "ttttable.h"
 #include "utils.h"
 
-#define GRID_LEN 3
-#define GRID_SIZE GRID_LEN * GRID_LEN
+#define GRID_LEN 3 // The classic board is drawn with numbered slots, other sizes are played with the cursor
 #define GRID_P1 1
 #define GRID_P2 -1
 #define GRID_EMPTY 0
 #define CH_P1 'O'
 #define CH_P2 'X'
-#define MSG_SIZE 16
+#define CH_EMPTY '.'
+#define MSG_SIZE 64
+#define THINK_MS 1000 // Time the computer takes for a move
+#define TABLE_BITS 20 // Positions the computer remembers, 16 bytes each
 
+static bool parse_options(int argc, char *argv[]);
 static void update();
+static void computer_move();
+static int table_index();
+static void place(int cell);
 static void print_grid();
-
-void check_winner();
-int check_horizontal();
-int check_vertical();
-int check_diagonal_lr();
-int check_diagonal_rl();
-
-// The game grid
-static int grid[GRID_SIZE] = {GRID_EMPTY};
+static void print_classic_grid();
+static void print_large_grid();
+static void check_winner(int cell);
+
+// The game grid, grid_k in a row wins
+static int grid[TTT_MAX_CELLS] = {GRID_EMPTY};
+static int grid_w;
+static int grid_h;
+static int grid_k;
+
+// The same stones as bitboards, which the computer searches
+static struct ttt_board board;
+static struct ttt_search search;
+static int computer;    // Player the computer plays, 0 if both players are human
+static bool use_table;  // The classic board's moves are looked up instead of searched
+static int max_depth;
+static double think_ms;
+static int mcts_threads; // Threads playing random games for the computer, -1 to search with alpha-beta instead
 
 static bool should_update;
 static bool game_end;
-static int input;
+static int cursor_x;
+static int cursor_y;
 int current_player;
 int winner;
 static char message[MSG_SIZE];
+static char search_info[MSG_SIZE];
 
-void tictactoe()
+int tictactoe(int argc, char *argv[])
 {
-    // Allow game to start
+    if (!parse_options(argc, argv))
+    {
+        printf("Usage: ./play tictactoe [--size width height k] [--ai 1|2] [--depth n] [--time ms] [--mcts threads]\n");
+        return 1;
+    }
+    use_table = grid_w == GRID_LEN && grid_h == GRID_LEN && grid_k == GRID_LEN;
+    if (computer != 0 && !use_table && mcts_threads < 0 && !ttt_search_init(&search, TABLE_BITS))
+    {
+        printf("Not enough memory for the computer player\n");
+        return 1;
+    }
+
+    // Allow game to start, from an empty board when the hub plays another round
     should_update = true;
     game_end = false;
+    for (int i = 0; i < TTT_MAX_CELLS; i++)
+    {
+        grid[i] = GRID_EMPTY;
+    }
+    message[0] = '\0';
+    search_info[0] = '\0';
 
-    // Start curses mode
-    initscr();
-
-    // Disable line buffering
-    cbreak();
-
-    // Don't echo user input
-    noecho();
-
-    // Set up colours
-    start_color();
-    use_default_colors();
-    init_pair(1, COLOR_CYAN, -1);
-    init_pair(2, COLOR_RED, -1);
+    // Start drawing, with a colour for each player
+    render_start(false);
+    render_colour(1, COLOR_CYAN, -1);
+    render_colour(2, COLOR_RED, -1);
 
     current_player = 1;
+    cursor_x = grid_w / 2;
+    cursor_y = grid_h / 2;
 
+    // The frame is shown before waiting for the key that answers it
     while (should_update)
     {
-        erase();
+        double start = trace_begin();
+        render_erase();
         print_grid();
+        trace_end("render", start);
+        render_present();
+        start = trace_begin();
         update();
-        refresh();
+        trace_end("update", start);
+    }
+
+    render_stop();
+    if (computer != 0 && !use_table && mcts_threads < 0)
+    {
+        ttt_search_free(&search);
     }
+    return 0;
+}
 
-    endwin();
+// Read the board size and the computer's settings, the defaults are the classic game between two players
+static bool parse_options(int argc, char *argv[])
+{
+    grid_w = GRID_LEN;
+    grid_h = GRID_LEN;
+    grid_k = GRID_LEN;
+    computer = 0;
+    max_depth = 64;
+    think_ms = THINK_MS;
+    mcts_threads = -1;
+    for (int i = 0; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--size") == 0 && i + 3 < argc)
+        {
+            grid_w = atoi(argv[++i]);
+            grid_h = atoi(argv[++i]);
+            grid_k = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--ai") == 0 && i + 1 < argc)
+        {
+            computer = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+        {
+            max_depth = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc)
+        {
+            think_ms = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--mcts") == 0 && i + 1 < argc)
+        {
+            mcts_threads = atoi(argv[++i]);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return (computer == 0 || computer == 1 || computer == 2) && max_depth >= 1 && think_ms > 0 && mcts_threads >= -1
+           && ttt_init(&board, grid_w, grid_h, grid_k);
 }
 
 static void update()
@@ -73,86 +160,214 @@ static void update()
     // If the game has ended, exit game on any button
     if (game_end)
     {
+        render_key(-1);
         should_update = false;
+        return;
+    }
+
+    // Let the computer play its turn
+    if (computer != 0 && current_player == (computer == 1 ? GRID_P1 : GRID_P2))
+    {
+        computer_move();
+        return;
     }
 
     // Get user input
-    input = getch();
-    input -= '0';
+    int input = render_key(-1);
     message[0] = '\0';
+    bool classic = grid_w == GRID_LEN && grid_h == GRID_LEN;
 
     // If input is 0, exit the game
-    if (input == 0)
+    if (input == '0')
     {
         should_update = false;
         return;
     }
 
-    // Check for valid input
-    else if (input < 1 || input > GRID_SIZE)
+    // Select a slot by its number on the classic board, or the one under the cursor
+    else if (classic && input >= '1' && input <= '9')
+    {
+        place(input - '1');
+    }
+    else if (input == ' ' || input == '\n' || input == KEY_ENTER)
+    {
+        place(cursor_y * grid_w + cursor_x);
+    }
+    else if (input == KEY_UP && cursor_y > 0)
+    {
+        cursor_y--;
+    }
+    else if (input == KEY_DOWN && cursor_y < grid_h - 1)
+    {
+        cursor_y++;
+    }
+    else if (input == KEY_LEFT && cursor_x > 0)
+    {
+        cursor_x--;
+    }
+    else if (input == KEY_RIGHT && cursor_x < grid_w - 1)
+    {
+        cursor_x++;
+    }
+    else if (classic && input != KEY_UP && input != KEY_DOWN && input != KEY_LEFT && input != KEY_RIGHT)
     {
         snprintf(message, MSG_SIZE, "Invalid number");
     }
+}
 
-    // Update grid
+// Search for the computer's move, showing that it's thinking while it does. Every position of the classic board
+// was solved when the game was built, so its move is looked up instead. With --mcts, random games are played
+// instead of searching, for boards too big to search deep enough. A search stops after a time, so it could find
+// another move when the game is replayed, and a replay makes the recorded move instead
+static void computer_move()
+{
+    if (use_table)
+    {
+        int cell = TTT_TABLE_MOVE[table_index()];
+        snprintf(search_info, MSG_SIZE, "Computer: perfect play table");
+        cursor_x = cell % grid_w;
+        cursor_y = cell / grid_w;
+        place(cell);
+        return;
+    }
+    render_print_at(render_cursor_y(), 0, "Thinking...");
+    render_present();
+    int move;
+    if (replay_move(&move))
+    {
+        snprintf(search_info, MSG_SIZE, "Computer: recorded move");
+    }
+    else if (mcts_threads >= 0)
+    {
+        struct ttt_mcts_result result = ttt_mcts_move(&board, mcts_threads, think_ms, rand_u64());
+        snprintf(search_info, MSG_SIZE, "Computer: %lli games, %.0f games/s on %i threads", result.playouts,
+                 result.ms > 0 ? result.playouts / (result.ms / 1000) : 0, result.threads);
+        move = result.move;
+    }
     else
     {
-        // Is grid spot already taken?
-        if (grid[input - 1] != 0)
+        struct ttt_result result = ttt_best_move(&search, &board, max_depth, think_ms);
+        snprintf(search_info, MSG_SIZE, "Computer: depth %i, %.0f nodes/s", result.depth,
+                 result.ms > 0 ? result.nodes / (result.ms / 1000) : 0);
+        move = result.move;
+    }
+    record_move(move);
+    cursor_x = move % grid_w;
+    cursor_y = move / grid_w;
+    place(move);
+}
+
+// Position of the classic board in the table, its slots are the digits of a base 3 number
+static int table_index()
+{
+    int index = 0;
+    for (int i = GRID_LEN * GRID_LEN - 1; i >= 0; i--)
+    {
+        index = index * 3 + (grid[i] == GRID_P1 ? 1 : grid[i] == GRID_P2 ? 2 : 0);
+    }
+    return index;
+}
+
+// Put the current player's piece on a slot if it's free, check whether it ended the game and hand the turn over
+static void place(int cell)
+{
+    // Is grid spot already taken?
+    if (grid[cell] != GRID_EMPTY)
+    {
+        snprintf(message, MSG_SIZE, "Already taken!");
+        return;
+    }
+    grid[cell] = current_player;
+    ttt_place(&board, current_player == GRID_P1 ? 0 : 1, cell);
+    check_winner(cell);
+    current_player *= -1;
+}
+
+static void print_grid()
+{
+    // Reset cursor position
+    render_move(0, 0);
+
+    if (grid_w == GRID_LEN && grid_h == GRID_LEN)
+    {
+        print_classic_grid();
+    }
+    else
+    {
+        print_large_grid();
+    }
+
+    // Print messages
+    if (game_end)
+    {
+        new_line(1);
+        if (winner == 0)
         {
-            snprintf(message, MSG_SIZE, "Already taken!");
+            render_print("Tie!");
         }
         else
         {
-            grid[input - 1] = current_player;
-            current_player *= -1;
+            render_print("Player %i won!", winner);
         }
+        new_line(1);
+        render_print("%s", search_info);
+        new_line(1);
+        render_print("Press any key to exit...");
+    }
+    else
+    {
+        new_line(1);
+        int p = current_player;
+        if (p != 1) { p = 2; }
+        render_print("Player %i's turn", p);
+        new_line(1);
+        render_print("%s", message);
+        new_line(1);
+        render_print("%s", search_info);
+        new_line(1);
     }
-
-    // Check for a winner
-    check_winner();
 }
 
-static void print_grid()
+// Draw the classic board with a number in every free slot
+static void print_classic_grid()
 {
-    // Reset cursor position
-    move(0, 0);
-
-    // Print grid
-    printw("     |     |    ");
+    render_print("     |     |    ");
     new_line(1);
-    for (int i = 0; i < GRID_SIZE; i++)
+    for (int i = 0; i < GRID_LEN * GRID_LEN; i++)
     {
+        int attrs = i == cursor_y * GRID_LEN + cursor_x && !game_end ? A_REVERSE : 0;
+        render_attr_on(attrs);
         if (grid[i] == GRID_P1)
         {
-            attron(COLOR_PAIR(1));
-            printw("  %c  ", CH_P1);
-            attroff(COLOR_PAIR(1));
+            render_attr_on(COLOR_PAIR(1));
+            render_print("  %c  ", CH_P1);
+            render_attr_off(COLOR_PAIR(1));
         }
         else if (grid[i] == GRID_P2)
         {
-            attron(COLOR_PAIR(2));
-            printw("  %c  ", CH_P2);
-            attroff(COLOR_PAIR(2));
+            render_attr_on(COLOR_PAIR(2));
+            render_print("  %c  ", CH_P2);
+            render_attr_off(COLOR_PAIR(2));
         }
         else
         {
-            printw("  %i  ", i + 1);
+            render_print("  %i  ", i + 1);
         }
+        render_attr_off(attrs);
 
         // Go to new line every 3 grid slots
         if ((i + 1) % GRID_LEN == 0)
         {
             new_line(1);
-            if (i > GRID_SIZE - GRID_LEN)
+            if (i > GRID_LEN * GRID_LEN - GRID_LEN)
             {
-                printw("     |     |    ");
+                render_print("     |     |    ");
             }
             else
             {
-                printw("_____|_____|_____");
+                render_print("_____|_____|_____");
                 new_line(1);
-                printw("     |     |    ");
+                render_print("     |     |    ");
             }
             new_line(1);
         }
@@ -160,115 +375,45 @@ static void print_grid()
         // Print vertical lines
         else
         {
-            printw("|");
+            render_print("|");
         }
     }
-
-    // Print messages
-    if (game_end)
-    {
-        new_line(1);
-        if (winner == 0)
-        {
-            printw("Tie!");
-        }
-        else
-        {
-            printw("Player %i won!", winner);
-        }
-        new_line(1);
-        printw("Press any key to exit...");
-    }
-    else
-    {
-        new_line(1);
-        int p = current_player;
-        if (p != 1) { p = 2; }
-        printw("Player %i's turn", p);
-        new_line(1);
-        printw("%s", message);
-    }
 }
 
-void check_winner()
+// Draw any other board compactly, a character per slot with the cursor on one of them
+static void print_large_grid()
 {
-    winner = check_horizontal();
-    if (abs(winner) != GRID_LEN)
+    for (int y = 0; y < grid_h; y++)
     {
-        winner = check_vertical();
-        if (abs(winner) != GRID_LEN)
+        for (int x = 0; x < grid_w; x++)
         {
-            winner = check_diagonal_lr();
-            if (abs(winner) != GRID_LEN)
+            int slot = grid[y * grid_w + x];
+            int attrs = slot == GRID_P1 ? COLOR_PAIR(1) : slot == GRID_P2 ? COLOR_PAIR(2) : 0;
+            if (x == cursor_x && y == cursor_y && !game_end)
             {
-                winner = check_diagonal_rl();
-            }
-        }
-    }
-
-    // Decode which player won
-    if (winner == GRID_LEN)
-    {
-        winner = 1;
-        game_end = true;
-    }
-    else if (winner == -GRID_LEN)
-    {
-        winner = 2;
-        game_end = true;
-    }
-
-    // If there is no winner, check if there are any remaining grid slots
-    else
-    {
-        game_end = true;
-        winner = 0;
-        for (int i = 0; i < GRID_SIZE; i++)
-        {
-            if (grid[i] == 0)
-            {
-                game_end = false;
+                attrs |= A_REVERSE;
             }
+            render_add(' ');
+            render_add((slot == GRID_P1 ? CH_P1 : slot == GRID_P2 ? CH_P2 : CH_EMPTY) | attrs);
         }
+        new_line(1);
     }
+    render_print("%i in a row wins", grid_k);
+    new_line(1);
 }
 
-// Check for a winner in the horizontal direction
-int check_horizontal()
+// Only the lines through the piece just placed can have become k in a row, and the board keeps count of its pieces
+static void check_winner(int cell)
 {
-    // Add the first 3 elements of the grid, if there is no winner,
-    // add the next 3 elements, and so on
-    for (int i = 0; i < GRID_SIZE; i += GRID_LEN)
+    int player = current_player == GRID_P1 ? 0 : 1;
+    if (ttt_wins(&board, player, cell))
     {
-        int sum = grid[i] + grid[i + 1] + grid[i + 2];
-        if (abs(sum) == GRID_LEN) { return sum; }
+        winner = player + 1;
+        game_end = true;
     }
-    return 0;
-}
-
-// Check for a winner in the vertical direction
-int check_vertical()
-{
-    // Add the every 3 elements of the grid, if there is no winner,
-    // add the next 3 elements, and so on
-    for (int i = 0; i < GRID_LEN; i++)
+    else if (ttt_full(&board))
     {
-        int sum = grid[i] + grid[i + 3] + grid[i + 6];
-        if (abs(sum) == GRID_LEN) { return sum; }
+        winner = 0;
+        game_end = true;
     }
-    return 0;
-}
-
-// Check for a winner in the top-left -> bottom-right diagonal direction
-int check_diagonal_lr()
-{
-    // Element 0, 4 and 8 of the grid line up diagonally from left to right
-    return grid[0] + grid[4] + grid[8];
-}
-
-// Check for a winner in the top-right -> bottom-left diagonal direction
-int check_diagonal_rl()
-{
-    // Element 2, 4 and 6 of the grid line up diagonally from right to left
-    return grid[2] + grid[4] + grid[6];
 }
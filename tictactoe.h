@@ -1 +1 @@
-void tictactoe();
+int tictactoe(int argc, char *argv[]);
@@ -0,0 +1,221 @@
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "utils.h"
+
+#define FIRST_EVENTS 4096
+#define MAX_EVENTS (1 << 22) // Spans kept per thread, later ones are dropped
+
+// A span of time spent in one phase, in microseconds on the monotonic clock
+struct event
+{
+    const char *name;
+    double start;
+    double duration;
+};
+
+// Each thread records into its own buffer without locking, the buffers are only walked once tracing stops
+struct buffer
+{
+    struct event *events;
+    int n;
+    int capacity;
+    int thread;
+    struct buffer *next;
+};
+
+// Frame times in milliseconds: the whole time between two frames, and the part of it not spent waiting
+struct frames
+{
+    double *interval;
+    double *busy;
+    int n;
+    int capacity;
+};
+
+static struct buffer *local_buffer();
+static void add_frame(double interval, double busy);
+static void print_percentiles(const char *name, double *times, int n);
+static int compare_times(const void *a, const void *b);
+
+bool trace_on = false;
+static FILE *output;
+static double origin;
+static struct buffer *buffers;
+static int thread_n;
+static pthread_mutex_t buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local struct buffer *buffer;
+static struct frames frames;
+static double last_frame;
+static double waited; // Since the last frame
+
+// Start recording spans, to be written to a Chrome trace file at the path when the program ends
+bool trace_start(const char *path)
+{
+    output = fopen(path, "w");
+    if (output == NULL)
+    {
+        return false;
+    }
+    origin = trace_now();
+    last_frame = -1;
+    trace_on = true;
+    atexit(trace_stop);
+    return true;
+}
+
+// Write every thread's spans as trace events, which chrome://tracing and Perfetto open, and print the frame times
+void trace_stop()
+{
+    if (!trace_on)
+    {
+        return;
+    }
+    trace_on = false;
+    fprintf(output, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (struct buffer *b = buffers; b != NULL; b = b->next)
+    {
+        for (int i = 0; i < b->n; i++)
+        {
+            const struct event *e = &b->events[i];
+            fprintf(output, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%i}",
+                    first ? "" : ",\n", e->name, e->start - origin, e->duration, b->thread);
+            first = false;
+        }
+    }
+    fprintf(output, "\n]}\n");
+    fclose(output);
+
+    if (frames.n > 0)
+    {
+        print_percentiles("Frame time", frames.busy, frames.n);
+        print_percentiles("Time between frames", frames.interval, frames.n);
+    }
+    while (buffers != NULL)
+    {
+        struct buffer *next = buffers->next;
+        free(buffers->events);
+        free(buffers);
+        buffers = next;
+    }
+    free(frames.interval);
+    free(frames.busy);
+}
+
+// Microseconds on the monotonic clock
+double trace_now()
+{
+    return now_ms() * 1e3;
+}
+
+// Record a span from start until now on the calling thread
+void trace_record(const char *name, double start)
+{
+    struct buffer *b = local_buffer();
+    if (b == NULL || (b->n == b->capacity && b->capacity == MAX_EVENTS))
+    {
+        return;
+    }
+    if (b->n == b->capacity)
+    {
+        struct event *events = realloc(b->events, sizeof(struct event) * b->capacity * 2);
+        if (events == NULL)
+        {
+            return;
+        }
+        b->events = events;
+        b->capacity *= 2;
+    }
+    b->events[b->n++] = (struct event) { name, start, trace_now() - start };
+}
+
+// Record time spent waiting for input, which doesn't count towards the time a frame took
+void trace_record_wait(double start)
+{
+    if (trace_on)
+    {
+        trace_record("input wait", start);
+        waited += trace_now() - start;
+    }
+}
+
+// Count a frame as presented. Its time is the time since the last one less the time spent waiting
+void trace_frame()
+{
+    if (!trace_on)
+    {
+        return;
+    }
+    double now = trace_now();
+    if (last_frame >= 0)
+    {
+        add_frame((now - last_frame) / 1e3, (now - last_frame - waited) / 1e3);
+    }
+    last_frame = now;
+    waited = 0;
+}
+
+static struct buffer *local_buffer()
+{
+    if (buffer != NULL)
+    {
+        return buffer;
+    }
+    struct buffer *b = malloc(sizeof(struct buffer));
+    struct event *events = malloc(sizeof(struct event) * FIRST_EVENTS);
+    if (b == NULL || events == NULL)
+    {
+        free(b);
+        free(events);
+        return NULL;
+    }
+    *b = (struct buffer) { events, 0, FIRST_EVENTS, 0, NULL };
+    pthread_mutex_lock(&buffers_lock);
+    b->thread = ++thread_n;
+    b->next = buffers;
+    buffers = b;
+    pthread_mutex_unlock(&buffers_lock);
+    buffer = b;
+    return b;
+}
+
+static void add_frame(double interval, double busy)
+{
+    if (frames.n == frames.capacity)
+    {
+        int capacity = frames.capacity > 0 ? frames.capacity * 2 : FIRST_EVENTS;
+        double *intervals = realloc(frames.interval, sizeof(double) * capacity);
+        if (intervals == NULL)
+        {
+            return;
+        }
+        frames.interval = intervals;
+        double *busies = realloc(frames.busy, sizeof(double) * capacity);
+        if (busies == NULL)
+        {
+            return;
+        }
+        frames.busy = busies;
+        frames.capacity = capacity;
+    }
+    frames.interval[frames.n] = interval;
+    frames.busy[frames.n] = busy;
+    frames.n++;
+}
+
+static void print_percentiles(const char *name, double *times, int n)
+{
+    qsort(times, n, sizeof(double), compare_times);
+    printf("%s: %.3f ms p50, %.3f ms p99, %.3f ms max over %i frames\n",
+           name, times[n / 2], times[(int) (n * 0.99)], times[n - 1], n);
+}
+
+static int compare_times(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
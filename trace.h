@@ -0,0 +1,29 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+extern bool trace_on;
+
+bool trace_start(const char *path);
+void trace_stop();
+double trace_now();
+void trace_record(const char *name, double start);
+void trace_record_wait(double start);
+void trace_frame();
+
+// Spans are timed with these two, which only look at the clock with --trace, so they can stay in every build
+static inline double trace_begin()
+{
+    return trace_on ? trace_now() : 0;
+}
+
+static inline void trace_end(const char *name, double start)
+{
+    if (trace_on)
+    {
+        trace_record(name, start);
+    }
+}
+
+#endif
@@ -0,0 +1,205 @@
+#include "tttboard.h"
+
+#include <string.h>
+#include "utils.h"
+
+#define MAX_WEIGHT 5 // Stones in a window past this count as this many, so the score can't overflow
+
+// The 4 lines through a cell: the words of both players and the bits the line covers in them
+struct line
+{
+    uint64_t own;
+    uint64_t other;
+    int bit;
+    int first;
+    int last;
+};
+
+static void lines_through(const struct ttt_board *b, int player, int cell, struct line lines[4]);
+static int run_length(uint64_t word, int bit);
+static int window_value(int own, int other);
+
+// Set up an empty board, returns false if it's too big or k doesn't fit on it
+bool ttt_init(struct ttt_board *b, int width, int height, int k)
+{
+    if (width < 1 || height < 1 || width > TTT_MAX_SIDE || height > TTT_MAX_SIDE || k < 1
+        || (k > width && k > height))
+    {
+        return false;
+    }
+    memset(b, 0, sizeof(*b));
+    b->width = width;
+    b->height = height;
+    b->k = k;
+    return true;
+}
+
+// Put a player's stone on an empty cell
+void ttt_place(struct ttt_board *b, int player, int cell)
+{
+    b->eval += player == 0 ? ttt_gain(b, 0, cell) : -ttt_gain(b, 1, cell);
+    ttt_mark(b, player, cell);
+    // Mixed with player + 1, as the first player's stone on cell 0 would otherwise leave the hash unchanged
+    b->hash ^= rng_mix((uint64_t) cell, (uint64_t) player + 1);
+}
+
+// Put a stone on an empty cell without updating the score or the hash, for playouts that only need to know who wins
+void ttt_mark(struct ttt_board *b, int player, int cell)
+{
+    int x = cell % b->width;
+    int y = cell / b->width;
+    b->rows[player][y] |= 1ULL << x;
+    b->cols[player][x] |= 1ULL << y;
+    b->diags[player][x - y + b->height - 1] |= 1ULL << x;
+    b->antis[player][x + y] |= 1ULL << x;
+    b->moves++;
+}
+
+// Take back the stone ttt_place() put on a cell
+void ttt_undo(struct ttt_board *b, int player, int cell)
+{
+    int x = cell % b->width;
+    int y = cell / b->width;
+    b->rows[player][y] &= ~(1ULL << x);
+    b->cols[player][x] &= ~(1ULL << y);
+    b->diags[player][x - y + b->height - 1] &= ~(1ULL << x);
+    b->antis[player][x + y] &= ~(1ULL << x);
+    b->hash ^= rng_mix((uint64_t) cell, (uint64_t) player + 1);
+    b->moves--;
+    b->eval -= player == 0 ? ttt_gain(b, 0, cell) : -ttt_gain(b, 1, cell);
+}
+
+// Whether the player's stone on a cell is part of k in a row, only the 4 lines through it can have changed
+bool ttt_wins(const struct ttt_board *b, int player, int cell)
+{
+    struct line lines[4];
+    lines_through(b, player, cell, lines);
+    for (int i = 0; i < 4; i++)
+    {
+        if (run_length(lines[i].own, lines[i].bit) >= b->k)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether a stone on an empty cell would make k in a row for the player
+bool ttt_would_win(const struct ttt_board *b, int player, int cell)
+{
+    struct line lines[4];
+    lines_through(b, player, cell, lines);
+    for (int i = 0; i < 4; i++)
+    {
+        if (run_length(lines[i].own | 1ULL << lines[i].bit, lines[i].bit) >= b->k)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// How much a stone on an empty cell would add to the player's score. Every window of k cells through it that the
+// other player has no stone in is worth more the more of the player's stones it holds, and a window it takes
+// from the other player loses that player what it was worth
+int ttt_gain(const struct ttt_board *b, int player, int cell)
+{
+    struct line lines[4];
+    lines_through(b, player, cell, lines);
+    int gain = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        const struct line *l = &lines[i];
+        int start = l->bit - b->k + 1 > l->first ? l->bit - b->k + 1 : l->first;
+        for (; start <= l->bit && start + b->k - 1 <= l->last; start++)
+        {
+            uint64_t mask = (~0ULL >> (64 - b->k)) << start;
+            int own = __builtin_popcountll(l->own & mask);
+            int other = __builtin_popcountll(l->other & mask);
+            gain += window_value(own + 1, other) - window_value(own, other);
+        }
+    }
+    return gain;
+}
+
+// List the empty cells within radius of a stone, found a row at a time by spreading each row's stones sideways
+// and then up and down. An empty board only has its middle cell. Returns the number of cells
+int ttt_candidates(const struct ttt_board *b, int radius, int *cells)
+{
+    if (b->moves == 0)
+    {
+        cells[0] = b->height / 2 * b->width + b->width / 2;
+        return 1;
+    }
+    uint64_t row_mask = ~0ULL >> (64 - b->width);
+    uint64_t spread[TTT_MAX_SIDE];
+    for (int y = 0; y < b->height; y++)
+    {
+        uint64_t taken = b->rows[0][y] | b->rows[1][y];
+        spread[y] = taken;
+        for (int r = 1; r <= radius; r++)
+        {
+            spread[y] |= taken << r | taken >> r;
+        }
+    }
+    int n = 0;
+    for (int y = 0; y < b->height; y++)
+    {
+        uint64_t near = 0;
+        for (int dy = -radius; dy <= radius; dy++)
+        {
+            near |= y + dy >= 0 && y + dy < b->height ? spread[y + dy] : 0;
+        }
+        near &= row_mask & ~(b->rows[0][y] | b->rows[1][y]);
+        while (near != 0)
+        {
+            cells[n++] = y * b->width + __builtin_ctzll(near);
+            near &= near - 1;
+        }
+    }
+    return n;
+}
+
+static void lines_through(const struct ttt_board *b, int player, int cell, struct line lines[4])
+{
+    int other = 1 - player;
+    int x = cell % b->width;
+    int y = cell / b->width;
+    int diag = x - y + b->height - 1;
+    int anti = x + y;
+    lines[0] = (struct line) { b->rows[player][y], b->rows[other][y], x, 0, b->width - 1 };
+    lines[1] = (struct line) { b->cols[player][x], b->cols[other][x], y, 0, b->height - 1 };
+
+    // A diagonal's cells are numbered by x, from where it enters the board to where it leaves
+    int first = x - y > 0 ? x - y : 0;
+    int last = x + (b->height - 1 - y) < b->width - 1 ? x + (b->height - 1 - y) : b->width - 1;
+    lines[2] = (struct line) { b->diags[player][diag], b->diags[other][diag], x, first, last };
+    first = x - (b->height - 1 - y) > 0 ? x - (b->height - 1 - y) : 0;
+    last = x + y < b->width - 1 ? x + y : b->width - 1;
+    lines[3] = (struct line) { b->antis[player][anti], b->antis[other][anti], x, first, last };
+}
+
+// Length of the run of set bits through a bit, counting the ones above it and below it with one instruction each
+static int run_length(uint64_t word, int bit)
+{
+    if (!(word >> bit & 1))
+    {
+        return 0;
+    }
+    int above = __builtin_ctzll(~(word >> bit >> 1));
+    int below = bit > 0 ? __builtin_clzll(~(word << (64 - bit))) : 0;
+    return 1 + above + below;
+}
+
+static int window_value(int own, int other)
+{
+    if (own > 0 && other > 0)
+    {
+        return 0;
+    }
+    if (other > 0)
+    {
+        return -(1 << 3 * (other < MAX_WEIGHT ? other : MAX_WEIGHT));
+    }
+    return own > 0 ? 1 << 3 * (own < MAX_WEIGHT ? own : MAX_WEIGHT) : 0;
+}
@@ -0,0 +1,49 @@
+#ifndef TTTBOARD_H
+#define TTTBOARD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TTT_MAX_SIDE 32
+#define TTT_MAX_CELLS (TTT_MAX_SIDE * TTT_MAX_SIDE)
+#define TTT_LINES (2 * TTT_MAX_SIDE - 1) // Diagonals in each direction on the largest board
+
+// A board of up to 32x32 cells where k in a row wins. Each player's rows, columns and both kinds of diagonal are
+// words with a bit per cell, so a stone sets one bit in 4 words and any line through a cell is one word
+struct ttt_board
+{
+    int width;
+    int height;
+    int k;
+    int moves;
+    uint64_t rows[2][TTT_MAX_SIDE];   // Bit x of row y
+    uint64_t cols[2][TTT_MAX_SIDE];   // Bit y of column x
+    uint64_t diags[2][TTT_LINES];     // Down and to the right, numbered by x - y + height - 1, bit x
+    uint64_t antis[2][TTT_LINES];     // Down and to the left, numbered by x + y, bit x
+    uint64_t hash;                    // Zobrist hash of the stones
+    int eval;                         // How much better player 0's lines are than player 1's
+};
+
+bool ttt_init(struct ttt_board *b, int width, int height, int k);
+void ttt_place(struct ttt_board *b, int player, int cell);
+void ttt_mark(struct ttt_board *b, int player, int cell);
+void ttt_undo(struct ttt_board *b, int player, int cell);
+bool ttt_wins(const struct ttt_board *b, int player, int cell);
+bool ttt_would_win(const struct ttt_board *b, int player, int cell);
+int ttt_gain(const struct ttt_board *b, int player, int cell);
+int ttt_candidates(const struct ttt_board *b, int radius, int *cells);
+
+// Player whose stone is on a cell, -1 if it's empty
+static inline int ttt_owner(const struct ttt_board *b, int cell)
+{
+    int x = cell % b->width;
+    int y = cell / b->width;
+    return b->rows[0][y] >> x & 1 ? 0 : b->rows[1][y] >> x & 1 ? 1 : -1;
+}
+
+static inline bool ttt_full(const struct ttt_board *b)
+{
+    return b->moves == b->width * b->height;
+}
+
+#endif
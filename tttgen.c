@@ -0,0 +1,113 @@
+// Works out the result and the best move of every position of the classic board with perfect play from both sides,
+// and prints them as ttttable.h for the game to be built with. Run by make before the game is compiled
+#include <stdbool.h>
+#include <stdio.h>
+
+#define CELLS 9
+#define POSITIONS 19683 // 3^9, every way to fill the board whether it can be reached or not
+#define PER_LINE 24
+
+static void solve(int *cells, int index, int player);
+static int winner(const int *cells);
+static void print_array(const char *name, const signed char *values);
+
+// Cell i of a position adds 3^i times 0 if it's empty, 1 for the first player and 2 for the second
+static const int POWERS[CELLS] = { 1, 3, 9, 27, 81, 243, 729, 2187, 6561 };
+static const int LINES[8][3] = {
+    { 0, 1, 2 }, { 3, 4, 5 }, { 6, 7, 8 }, { 0, 3, 6 }, { 1, 4, 7 }, { 2, 5, 8 }, { 0, 4, 8 }, { 2, 4, 6 },
+};
+
+static signed char values[POSITIONS]; // For the player to move: 1 for a win, 0 for a tie and -1 for a loss
+static signed char moves[POSITIONS];  // -1 if the game is over or the position can't be reached
+static signed char plies[POSITIONS];  // Moves left with perfect play, so wins are quick and losses slow
+static bool solved[POSITIONS];
+static int reachable;
+
+int main()
+{
+    int cells[CELLS] = { 0 };
+    solve(cells, 0, 1);
+    for (int i = 0; i < POSITIONS; i++)
+    {
+        moves[i] = solved[i] ? moves[i] : -1;
+    }
+
+    printf("// Generated by tttgen.c, don't edit\n");
+    printf("#ifndef TTTTABLE_H\n#define TTTTABLE_H\n\n");
+    printf("// %i positions can be reached, each is indexed by its cells in base 3\n", reachable);
+    printf("#define TTT_TABLE_SIZE %i\n\n", POSITIONS);
+    print_array("TTT_TABLE_VALUE", values);
+    print_array("TTT_TABLE_MOVE", moves);
+    printf("#endif\n");
+    return 0;
+}
+
+// Solve a position and every position that can follow it, each one only once
+static void solve(int *cells, int index, int player)
+{
+    if (solved[index])
+    {
+        return;
+    }
+    solved[index] = true;
+    reachable++;
+    moves[index] = -1;
+    plies[index] = 0;
+
+    // The last move won, so the player to move has lost
+    if (winner(cells) != 0)
+    {
+        values[index] = -1;
+        return;
+    }
+
+    int best_value = -2;
+    int best_plies = 0;
+    for (int i = 0; i < CELLS; i++)
+    {
+        if (cells[i] != 0)
+        {
+            continue;
+        }
+        cells[i] = player;
+        int next = index + player * POWERS[i];
+        solve(cells, next, 3 - player);
+        cells[i] = 0;
+
+        int value = -values[next];
+        int length = plies[next] + 1;
+        if (value > best_value || (value == best_value && (value > 0 ? length < best_plies : length > best_plies)))
+        {
+            best_value = value;
+            best_plies = length;
+            moves[index] = (signed char) i;
+        }
+    }
+
+    // No empty cells left is a tie
+    values[index] = (signed char) (best_value == -2 ? 0 : best_value);
+    plies[index] = (signed char) best_plies;
+}
+
+static int winner(const int *cells)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        int a = cells[LINES[i][0]];
+        if (a != 0 && a == cells[LINES[i][1]] && a == cells[LINES[i][2]])
+        {
+            return a;
+        }
+    }
+    return 0;
+}
+
+static void print_array(const char *name, const signed char *array)
+{
+    printf("static const signed char %s[TTT_TABLE_SIZE] = {", name);
+    for (int i = 0; i < POSITIONS; i++)
+    {
+        printf(i % PER_LINE == 0 ? "\n    %i," : " %i,", array[i]);
+    }
+    printf("\n};\n\n");
+}
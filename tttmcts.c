@@ -0,0 +1,309 @@
+#include "tttmcts.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "trace.h"
+#include "utils.h"
+
+#define NODE_BITS 18       // Nodes each thread's tree can hold, 20 bytes each so 5 MiB per thread
+#define CHECK_PLAYOUTS 64  // Playouts between two looks at the clock
+#define EXPLORATION 1.0    // How much less visited moves are favoured over moves that won more
+#define UNKNOWN -1
+#define DRAW 2
+
+// A move in a thread's tree, with how often the games through it were won by the player who made it
+struct node
+{
+    int first_child;
+    int16_t child_n;
+    int16_t move;
+    int8_t winner;    // UNKNOWN until the node is reached, then the player who won with it, DRAW, or still UNKNOWN
+    bool expanded;
+    uint32_t visits;
+    float wins;       // A draw counts as half a win
+};
+
+// The search of one thread. Every thread grows its own tree from the same position, so they never wait for each
+// other, and the visits of their first moves are added up at the end
+struct worker
+{
+    const struct ttt_board *root;
+    double deadline;
+    uint64_t seed;
+    int radius;
+    struct node *nodes;
+    int node_n;
+    long long playouts;
+    uint32_t visits[TTT_MAX_CELLS]; // Of each move from the root
+};
+
+static int forced_move(const struct ttt_board *b);
+static void *search_worker(void *arg);
+static void iterate(struct worker *w, struct rng *r);
+static int select_child(const struct worker *w, const struct node *parent);
+static bool expand(struct worker *w, struct node *n, const struct ttt_board *b, struct rng *r);
+static int playout(struct ttt_board *b, int player, struct rng *r);
+static int default_threads();
+
+// Pick a move by playing random games from the position for time_ms on each of the threads, 0 threads uses every
+// core. A move that wins at once, or stops the other player from winning at once, is played without searching.
+// The board must have an empty cell and no winner yet
+struct ttt_mcts_result ttt_mcts_move(const struct ttt_board *b, int threads, double time_ms, uint64_t seed)
+{
+    struct ttt_mcts_result result = { forced_move(b), 0, 1, 0 };
+    if (result.move >= 0)
+    {
+        return result;
+    }
+
+    threads = threads > 0 ? threads : default_threads();
+    threads = threads > TTT_MCTS_MAX_THREADS ? TTT_MCTS_MAX_THREADS : threads;
+    struct worker *workers = calloc((size_t) threads, sizeof(struct worker));
+    pthread_t ids[TTT_MCTS_MAX_THREADS];
+    if (workers == NULL)
+    {
+        return result;
+    }
+    double start = now_ms();
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].root = b;
+        workers[t].deadline = start + time_ms;
+        workers[t].seed = rng_mix(seed ^ b->hash, (uint64_t) t);
+        workers[t].radius = b->k >= 5 ? 1 : 2;
+    }
+    // The threads only live for one move. Starting them takes tens of microseconds against a search of hundreds of
+    // milliseconds, and nothing is left running between moves
+    int started = 1;
+    for (int t = 1; t < threads; t++)
+    {
+        if (pthread_create(&ids[t], NULL, search_worker, &workers[t]) != 0)
+        {
+            break;
+        }
+        started++;
+    }
+    search_worker(&workers[0]);
+    for (int t = 1; t < started; t++)
+    {
+        pthread_join(ids[t], NULL);
+    }
+
+    // The move played most often is the one the searches trusted most
+    uint64_t best = 0;
+    for (int cell = 0; cell < b->width * b->height; cell++)
+    {
+        uint64_t visits = 0;
+        for (int t = 0; t < started; t++)
+        {
+            visits += workers[t].visits[cell];
+        }
+        if (visits > best)
+        {
+            best = visits;
+            result.move = cell;
+        }
+    }
+    for (int t = 0; t < started; t++)
+    {
+        result.playouts += workers[t].playouts;
+    }
+    result.threads = started;
+    result.ms = now_ms() - start;
+    free(workers);
+
+    // A thread that couldn't allocate its tree leaves no visits
+    if (result.move < 0)
+    {
+        int cells[TTT_MAX_CELLS];
+        ttt_candidates(b, 1, cells);
+        result.move = cells[0];
+    }
+    return result;
+}
+
+// A move that wins for the player to move, or else one that the other player would win with
+static int forced_move(const struct ttt_board *b)
+{
+    int cells[TTT_MAX_CELLS];
+    int n = ttt_candidates(b, 1, cells);
+    int player = b->moves % 2;
+    for (int other = 0; other < 2; other++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (ttt_would_win(b, other == 0 ? player : 1 - player, cells[i]))
+            {
+                return cells[i];
+            }
+        }
+    }
+    return -1;
+}
+
+static void *search_worker(void *arg)
+{
+    struct worker *w = arg;
+    w->nodes = malloc(sizeof(struct node) << NODE_BITS);
+    if (w->nodes == NULL)
+    {
+        return NULL;
+    }
+    w->nodes[0] = (struct node) { 0, 0, -1, UNKNOWN, false, 0, 0 };
+    w->node_n = 1;
+    struct rng r;
+    rng_seed(&r, w->seed);
+    double start = trace_begin();
+    do
+    {
+        for (int i = 0; i < CHECK_PLAYOUTS; i++)
+        {
+            iterate(w, &r);
+        }
+    } while (now_ms() < w->deadline);
+    trace_end("search", start);
+
+    const struct node *root = &w->nodes[0];
+    for (int i = 0; i < root->child_n; i++)
+    {
+        const struct node *child = &w->nodes[root->first_child + i];
+        w->visits[child->move] = child->visits;
+    }
+    free(w->nodes);
+    return NULL;
+}
+
+// Follow the most promising moves down the tree, add the moves of the position it ends on, play a random game
+// from there and count its result on the way back up
+static void iterate(struct worker *w, struct rng *r)
+{
+    struct ttt_board b = *w->root;
+    int path[TTT_MAX_CELLS + 1];
+    int length = 0;
+    int index = 0;
+    int winner = UNKNOWN;
+    path[length++] = 0;
+    while (true)
+    {
+        struct node *n = &w->nodes[index];
+        if (n->winner != UNKNOWN)
+        {
+            winner = n->winner;
+            break;
+        }
+        if (!n->expanded && (n->visits == 0 || !expand(w, n, &b, r)))
+        {
+            winner = playout(&b, b.moves % 2, r);
+            break;
+        }
+
+        // Play the chosen move, and remember whether it ends the game for the next time it's chosen
+        index = select_child(w, n);
+        struct node *child = &w->nodes[index];
+        int player = b.moves % 2;
+        ttt_mark(&b, player, child->move);
+        path[length++] = index;
+        if (child->visits == 0)
+        {
+            child->winner = ttt_wins(&b, player, child->move) ? player : ttt_full(&b) ? DRAW : UNKNOWN;
+        }
+    }
+
+    // Each node's move was made by the player who didn't move from the node before it
+    int mover = w->root->moves % 2;
+    for (int i = 0; i < length; i++)
+    {
+        struct node *n = &w->nodes[path[i]];
+        n->visits++;
+        n->wins += winner == DRAW ? 0.5f : winner == 1 - mover ? 1 : 0;
+        mover = 1 - mover;
+    }
+    w->playouts++;
+}
+
+// The child with the best upper bound on how often it wins, any child that was never tried first
+static int select_child(const struct worker *w, const struct node *parent)
+{
+    double log_visits = log(parent->visits);
+    double best_score = -1;
+    int best = parent->first_child;
+    for (int i = parent->first_child; i < parent->first_child + parent->child_n; i++)
+    {
+        const struct node *child = &w->nodes[i];
+        if (child->visits == 0)
+        {
+            return i;
+        }
+        double score = child->wins / child->visits + EXPLORATION * sqrt(log_visits / child->visits);
+        if (score > best_score)
+        {
+            best_score = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Add a child for every move near the stones, in a random order so untried moves are tried in a random order too.
+// Returns false when the tree is full
+static bool expand(struct worker *w, struct node *n, const struct ttt_board *b, struct rng *r)
+{
+    int cells[TTT_MAX_CELLS];
+    int count = ttt_candidates(b, w->radius, cells);
+    if (w->node_n + count > 1 << NODE_BITS)
+    {
+        return false;
+    }
+    n->first_child = w->node_n;
+    n->child_n = (int16_t) count;
+    n->expanded = true;
+    for (int i = 0; i < count; i++)
+    {
+        int j = rng_range(r, i, count - 1);
+        int cell = cells[j];
+        cells[j] = cells[i];
+        w->nodes[w->node_n++] = (struct node) { 0, 0, (int16_t) cell, UNKNOWN, false, 0, 0 };
+    }
+    return true;
+}
+
+// Fill the empty cells in a random order until someone has k in a row. Returns the winner, or DRAW
+static int playout(struct ttt_board *b, int player, struct rng *r)
+{
+    int cells[TTT_MAX_CELLS];
+    int n = 0;
+    uint64_t row_mask = ~0ULL >> (64 - b->width);
+    for (int y = 0; y < b->height; y++)
+    {
+        uint64_t empty = ~(b->rows[0][y] | b->rows[1][y]) & row_mask;
+        while (empty != 0)
+        {
+            cells[n++] = y * b->width + __builtin_ctzll(empty);
+            empty &= empty - 1;
+        }
+    }
+    while (n > 0)
+    {
+        int i = rng_range(r, 0, n - 1);
+        int cell = cells[i];
+        cells[i] = cells[--n];
+        ttt_mark(b, player, cell);
+        if (ttt_wins(b, player, cell))
+        {
+            return player;
+        }
+        player = 1 - player;
+    }
+    return DRAW;
+}
+
+static int default_threads()
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int) cores : 1;
+}
+
@@ -0,0 +1,18 @@
+#ifndef TTTMCTS_H
+#define TTTMCTS_H
+
+#include "tttboard.h"
+
+#define TTT_MCTS_MAX_THREADS 256
+
+struct ttt_mcts_result
+{
+    int move;
+    long long playouts; // Random games played to the end, over all threads
+    int threads;
+    double ms;
+};
+
+struct ttt_mcts_result ttt_mcts_move(const struct ttt_board *b, int threads, double time_ms, uint64_t seed);
+
+#endif
@@ -0,0 +1,231 @@
+#include "tttsearch.h"
+
+#include <stdlib.h>
+#include "utils.h"
+
+#define MAX_PLY 64
+#define CHECK_NODES 1024 // Nodes between two looks at the clock
+#define INF (TTT_WIN + 1)
+#define WIDE_BRANCHES 12 // Moves searched from a position on boards needing 5 or more in a row
+
+enum bound
+{
+    BOUND_NONE,
+    BOUND_EXACT,
+    BOUND_LOWER, // The score is at least this
+    BOUND_UPPER, // The score is at most this
+};
+
+static int negamax(struct ttt_search *s, struct ttt_board *b, int depth, int alpha, int beta, int ply);
+static int best_last_move(const struct ttt_board *b, int player, const int *cells, int n, int ply);
+static void order_moves(const struct ttt_board *b, int player, int *cells, int n, int first);
+static int to_table(int score, int ply);
+static int from_table(int score, int ply);
+
+// Allocate a transposition table of 2^table_bits entries
+bool ttt_search_init(struct ttt_search *s, int table_bits)
+{
+    s->table = calloc((size_t) 1 << table_bits, sizeof(struct ttt_entry));
+    s->table_mask = ((uint64_t) 1 << table_bits) - 1;
+    return s->table != NULL;
+}
+
+void ttt_search_free(struct ttt_search *s)
+{
+    free(s->table);
+    s->table = NULL;
+}
+
+// Search one move deeper at a time until max_depth or until time_ms runs out, keeping the best move of the
+// deepest search. The table carries each search's best moves over to the next one, which looks at them first.
+// The board must have an empty cell and no winner yet
+struct ttt_result ttt_best_move(struct ttt_search *s, struct ttt_board *b, int max_depth, double time_ms)
+{
+    struct ttt_result result = { -1, 0, 0, 0, 0 };
+    double start = now_ms();
+    s->deadline = start + time_ms;
+    s->stopped = false;
+    s->nodes = 0;
+    s->radius = b->k >= 5 ? 1 : 2;
+    s->branches = b->k >= 5 ? WIDE_BRANCHES : TTT_MAX_CELLS;
+    s->root_move = -1;
+
+    int left = b->width * b->height - b->moves;
+    max_depth = max_depth < left ? max_depth : left;
+    max_depth = max_depth < MAX_PLY ? max_depth : MAX_PLY;
+    for (int depth = 1; depth <= max_depth; depth++)
+    {
+        int score = negamax(s, b, depth, -INF, INF, 0);
+        result.move = s->root_move;
+        if (s->stopped)
+        {
+            break;
+        }
+        result.score = score;
+        result.depth = depth;
+
+        // Nothing changes once the game is decided
+        if (score >= TTT_WIN - MAX_PLY || score <= -TTT_WIN + MAX_PLY)
+        {
+            break;
+        }
+    }
+    result.nodes = s->nodes;
+    result.ms = now_ms() - start;
+    return result;
+}
+
+static int negamax(struct ttt_search *s, struct ttt_board *b, int depth, int alpha, int beta, int ply)
+{
+    // Stop when time is up, but never before a move was found
+    s->nodes++;
+    if (s->nodes % CHECK_NODES == 0 && s->root_move >= 0 && now_ms() > s->deadline)
+    {
+        s->stopped = true;
+    }
+    if (s->stopped)
+    {
+        return 0;
+    }
+    int player = b->moves % 2;
+    if (depth == 0)
+    {
+        return player == 0 ? b->eval : -b->eval;
+    }
+
+    struct ttt_entry *entry = &s->table[b->hash & s->table_mask];
+    int table_move = -1;
+    if (entry->hash == b->hash && entry->bound != BOUND_NONE)
+    {
+        table_move = entry->move;
+        int score = from_table(entry->score, ply);
+        if (ply > 0 && entry->depth >= depth
+            && (entry->bound == BOUND_EXACT || (entry->bound == BOUND_LOWER && score >= beta)
+                || (entry->bound == BOUND_UPPER && score <= alpha)))
+        {
+            return score;
+        }
+    }
+
+    int cells[TTT_MAX_CELLS];
+    int n = ttt_candidates(b, s->radius, cells);
+
+    // The score after each last move is the score now plus what the move gains, so they don't have to be played
+    if (depth == 1 && ply > 0)
+    {
+        s->nodes += n;
+        return best_last_move(b, player, cells, n, ply);
+    }
+    order_moves(b, player, cells, n, table_move);
+    n = n < s->branches ? n : s->branches;
+    int start_alpha = alpha;
+    int best = -INF;
+    int best_move = cells[0];
+    for (int i = 0; i < n; i++)
+    {
+        ttt_place(b, player, cells[i]);
+        int score;
+        if (ttt_wins(b, player, cells[i]))
+        {
+            score = TTT_WIN - ply - 1;
+        }
+        else if (ttt_full(b))
+        {
+            score = 0;
+        }
+        else if (i == 0)
+        {
+            score = -negamax(s, b, depth - 1, -beta, -alpha, ply + 1);
+        }
+
+        // The first move is most likely the best, the others are only searched fully if they might beat it
+        else
+        {
+            score = -negamax(s, b, depth - 1, -alpha - 1, -alpha, ply + 1);
+            if (score > alpha && score < beta)
+            {
+                score = -negamax(s, b, depth - 1, -beta, -alpha, ply + 1);
+            }
+        }
+        ttt_undo(b, player, cells[i]);
+        if (s->stopped)
+        {
+            return 0;
+        }
+
+        if (score > best)
+        {
+            best = score;
+            best_move = cells[i];
+            if (ply == 0)
+            {
+                s->root_move = best_move;
+            }
+        }
+        alpha = score > alpha ? score : alpha;
+        if (alpha >= beta)
+        {
+            break;
+        }
+    }
+
+    entry->hash = b->hash;
+    entry->score = to_table(best, ply);
+    entry->move = (int16_t) best_move;
+    entry->depth = (int8_t) depth;
+    entry->bound = best <= start_alpha ? BOUND_UPPER : best >= beta ? BOUND_LOWER : BOUND_EXACT;
+    return best;
+}
+
+static int best_last_move(const struct ttt_board *b, int player, const int *cells, int n, int ply)
+{
+    int eval = player == 0 ? b->eval : -b->eval;
+    bool fills = b->moves + 1 == b->width * b->height;
+    int best = -INF;
+    for (int i = 0; i < n; i++)
+    {
+        if (ttt_would_win(b, player, cells[i]))
+        {
+            return TTT_WIN - ply - 1;
+        }
+        int score = fills ? 0 : eval + ttt_gain(b, player, cells[i]);
+        best = score > best ? score : best;
+    }
+    return best;
+}
+
+// Put the table's move first, then the moves that do the most for the player and against the other player
+static void order_moves(const struct ttt_board *b, int player, int *cells, int n, int first)
+{
+    int scores[TTT_MAX_CELLS];
+    for (int i = 0; i < n; i++)
+    {
+        scores[i] = cells[i] == first ? INF : ttt_gain(b, player, cells[i]) + ttt_gain(b, 1 - player, cells[i]);
+    }
+    for (int i = 1; i < n; i++)
+    {
+        int cell = cells[i];
+        int score = scores[i];
+        int j = i;
+        for (; j > 0 && scores[j - 1] < score; j--)
+        {
+            cells[j] = cells[j - 1];
+            scores[j] = scores[j - 1];
+        }
+        cells[j] = cell;
+        scores[j] = score;
+    }
+}
+
+// Wins are stored as the moves left from the stored position instead of from the root, so they stay right
+// wherever the position comes up again
+static int to_table(int score, int ply)
+{
+    return score >= TTT_WIN - MAX_PLY ? score + ply : score <= -TTT_WIN + MAX_PLY ? score - ply : score;
+}
+
+static int from_table(int score, int ply)
+{
+    return score >= TTT_WIN - MAX_PLY ? score - ply : score <= -TTT_WIN + MAX_PLY ? score + ply : score;
+}
+
@@ -0,0 +1,46 @@
+#ifndef TTTSEARCH_H
+#define TTTSEARCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "tttboard.h"
+
+#define TTT_WIN 1000000 // Score of a won position, less the moves it takes to get there
+
+// A position already searched: its score, how deep, whether the score is exact or only a bound, and its best move
+struct ttt_entry
+{
+    uint64_t hash;
+    int score;
+    int16_t move;
+    int8_t depth;
+    uint8_t bound;
+};
+
+// Negamax with alpha-beta pruning, searching one move deeper each time until it runs out of time
+struct ttt_search
+{
+    struct ttt_entry *table;
+    uint64_t table_mask;
+    long long nodes;
+    double deadline;
+    bool stopped;
+    int radius;    // How far from the stones moves are looked for
+    int branches;  // Most moves searched from a position, the rest are left out
+    int root_move; // Best move found so far at the root
+};
+
+struct ttt_result
+{
+    int move;
+    int score; // For the player to move
+    int depth; // Deepest search that finished
+    long long nodes;
+    double ms;
+};
+
+bool ttt_search_init(struct ttt_search *s, int table_bits);
+void ttt_search_free(struct ttt_search *s);
+struct ttt_result ttt_best_move(struct ttt_search *s, struct ttt_board *b, int max_depth, double time_ms);
+
+#endif
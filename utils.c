@@ -1,65 +1,137 @@
 #include "utils.h"
 
-#include <ncurses.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 
-bool is_seeded = false;
+static uint64_t rotl(uint64_t x, int k);
+static void seed_once();
+static struct rng *thread_rng();
 
-// Move down or up relative to the current cursor position
-void move_rel_y(int amount)
+static uint64_t seed;
+static bool is_seeded = false;
+static atomic_uint thread_count;
+static _Thread_local struct rng thread_generator;
+static _Thread_local bool thread_seeded = false;
+
+// Fill the generator's state from one number, so nearby seeds still give unrelated sequences
+void rng_seed(struct rng *r, uint64_t seed)
 {
-    int y, x;
-    getyx(stdscr, y, x);
-    move(y + amount, x);
+    for (int i = 0; i < 4; i++)
+    {
+        seed += 0x9E3779B97F4A7C15ULL;
+        r->state[i] = rng_mix(seed, 0);
+    }
 }
 
-// Move only the x coordinate of the cursor
-void move_x(int new_x)
+uint64_t rng_next(struct rng *r)
 {
-    int y, x;
-    getyx(stdscr, y, x);
-    move(y, new_x);
+    uint64_t *s = r->state;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
 }
 
-// Move the cursor to the beginning and down by 'lines'
-void new_line(int lines)
+// Returns a random number between the specified range. Multiplying by the size of the range instead of taking
+// a remainder, and rejecting the few values that would come up once too often, keeps every number equally likely
+int rng_range(struct rng *r, int min, int max)
 {
-    if (lines < 1)
+    uint32_t range = (uint32_t) ((int64_t) max - min + 1);
+    if (range == 0)
     {
-        return;
+        return (int) (int32_t) (rng_next(r) >> 32);
     }
-    else
+    uint64_t product = (rng_next(r) >> 32) * range;
+    if ((uint32_t) product < range)
     {
-        move_x(0);
-        move_rel_y(lines);
+        uint32_t threshold = -range % range;
+        while ((uint32_t) product < threshold)
+        {
+            product = (rng_next(r) >> 32) * range;
+        }
     }
+    return (int) ((int64_t) min + (int64_t) (product >> 32));
+}
+
+// Combine a seed with a stream number, e.g. a game or thread number, into a well mixed 64-bit number
+uint64_t rng_mix(uint64_t seed, uint64_t stream)
+{
+    uint64_t z = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
 }
 
-// Returns the width of the window
-int get_width()
+// Set the seed every game starts from, so a game can be played again exactly. The calling thread and the threads
+// started after it draw from the new seed as if the process had just started with it
+void rand_seed(uint64_t new_seed)
 {
-    int y, x;
-    getmaxyx(stdscr, y, x);
-    return x;
+    seed = new_seed;
+    is_seeded = true;
+    thread_seeded = false;
+    atomic_store(&thread_count, 0);
 }
 
-// Returns the height of the window
-int get_height()
+// Returns the seed in use, picking one from the clock and process id if none was given
+uint64_t rand_get_seed()
 {
-    int y, x;
-    getmaxyx(stdscr, y, x);
-    return y;
+    seed_once();
+    return seed;
 }
 
-// Returns a random number between the specified range, automatically seeded with the current time
+// Returns 64 random bits from the calling thread's generator. Every thread, the first included, gets its own stream
+// of the seed, numbered in the order the threads first ask for a number
+uint64_t rand_u64()
+{
+    return rng_next(thread_rng());
+}
+
+// Returns a random number between the specified range from the calling thread's generator
 int rand_range(int min, int max)
+{
+    return rng_range(thread_rng(), min, max);
+}
+
+// Milliseconds on the monotonic clock, which every timing in the games is measured with
+double now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+// Sessions started in the same second still get different seeds from the nanoseconds and process id
+static void seed_once()
 {
     if (!is_seeded)
     {
-        srand(time(0));
-        is_seeded = true;
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        rand_seed(rng_mix((uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec, getpid()));
+    }
+}
+
+// The calling thread's generator, seeded the first time the thread asks for a number
+static struct rng *thread_rng()
+{
+    if (!thread_seeded)
+    {
+        seed_once();
+        rng_seed(&thread_generator, rng_mix(seed, atomic_fetch_add(&thread_count, 1)));
+        thread_seeded = true;
     }
-    return rand() % (max - min + 1) + min;
+    return &thread_generator;
 }
@@ -1,6 +1,22 @@
-void move_rel_y(int rows);
-void move_x(int new_x);
-void new_line(int lines);
-int get_width();
-int get_height();
+#ifndef UTILS_H
+#define UTILS_H
+
+#include <stdint.h>
+
+// A xoshiro256** generator, every thread or bulk job can own one so nothing is shared
+struct rng
+{
+    uint64_t state[4];
+};
+
+void rng_seed(struct rng *r, uint64_t seed);
+uint64_t rng_next(struct rng *r);
+int rng_range(struct rng *r, int min, int max);
+uint64_t rng_mix(uint64_t seed, uint64_t stream);
+void rand_seed(uint64_t seed);
+uint64_t rand_get_seed();
+uint64_t rand_u64();
 int rand_range(int min, int max);
+double now_ms();
+
+#endif